@@ -1,21 +1,27 @@
 #include "Application.h"
 
+#include <SFML/Window/Context.hpp>
 #include <SFML/Window/ContextSettings.hpp>
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/System/Clock.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+
+#include <algorithm>
+#include <stdexcept>
 
 #include "Config.h"
 
-Application::Application(std::string name) 
+Application::Application(std::string name, bool headless) 
 	: m_window(
 		std::move(name), 
-		sf::VideoMode().getDesktopMode(), 
+		headless ? sf::VideoMode() : sf::VideoMode().getDesktopMode(), 
 		WindowBorder::Fullscreen, 
 		Config::Inst().Misc.VerticalSync, 
 		Config::Inst().Misc.MaxFramerate)
 	, m_inputHandler()
+	, m_inputRecorder()
 	, m_textureHolder()
-	, m_mainState(State::Context(m_window, m_camera, m_inputHandler, m_textureHolder, m_fontHolder))
+	, m_mainState(State::Context(m_window, m_camera, m_inputHandler, m_inputRecorder, m_textureHolder, m_fontHolder))
 {
 	m_camera.SetScale({ Config::Inst().Misc.CameraZoom, Config::Inst().Misc.CameraZoom });
 
@@ -27,27 +33,27 @@ Application::Application(std::string name)
 
 void Application::Run()
 {
+	m_inputRecorder.Initialize(); // before anything random is generated
 	m_window.Initialize();
-	m_mainState.Initialize();
+	m_mainState.Initialize(m_window.getSize());
 
 	m_camera.SetSize(sf::Vector2f(m_window.getSize()));
 	m_camera.SetPosition(m_camera.GetSize() / 2.0f);
 
+	if (!Config::Inst().Misc.CapturePath.empty())
+		OpenCapture(m_window.getSize());
+
 	sf::Clock clock;
 	float dt = FLT_EPSILON;
 
-	float fixedDT = 1.0f / 60.0f;
 	float accumulator = FLT_EPSILON;
 
-	int ticks = 0;
-	int deathSpiral = 12; // guarantee prevention of infinite loop
-
 	while (m_window.isOpen())
 	{
 		dt = std::fminf(clock.restart().asSeconds(), 0.075f);
-		accumulator += dt;
 
-		fixedDT = 1.0f / std::fmaxf(Config::Inst().Misc.PhysicsUpdateFreq, 1.0f);
+		if (m_frameCapture.IsActive()) // advance by a fixed amount so that no frames are dropped in the recording
+			dt = 1.0f / std::fmaxf(Config::Inst().Misc.CaptureFramerate, 1.0f);
 
 		m_inputHandler.Update(dt);
 
@@ -57,18 +63,94 @@ void Application::Run()
 
 		Update(dt);
 
-		ticks = 0;
+		if (!Step(dt, accumulator, m_camera.GetMouseWorldPosition(m_window)))
+		{
+			m_window.close();
+			break;
+		}
+
+		Draw();
+	}
+
+	CloseCapture();
+}
+
+void Application::RunHeadless()
+{
+	const MiscConfig& misc = Config::Inst().Misc;
+
+	if (misc.CapturePath.empty())
+		throw std::runtime_error("Headless capture needs a capture path");
+
+	sf::Context context; // owned by the window otherwise, every resource and the capture target share it
+
+	const sf::Vector2u size(std::max(misc.CaptureWidth, 1u), std::max(misc.CaptureHeight, 1u));
+
+	m_inputRecorder.Initialize(); // before anything random is generated
+
+	if (misc.CaptureFrames == 0 && !m_inputRecorder.IsReplaying())
+		throw std::runtime_error("Headless capture needs a frame count or a replay to stop at");
+
+	m_mainState.Initialize(size);
+
+	m_camera.SetSize(sf::Vector2f(size));
+	m_camera.SetPosition(m_camera.GetSize() / 2.0f);
+
+	OpenCapture(size);
+
+	const float dt = 1.0f / std::fmaxf(misc.CaptureFramerate, 1.0f);
+	float accumulator = FLT_EPSILON;
+
+	for (std::size_t frame = 0; misc.CaptureFrames == 0 || frame < misc.CaptureFrames; ++frame)
+	{
+		m_inputHandler.Update(dt);
+
+		m_mainState.PreUpdate(dt); // without a window there is no mouse for the camera to follow
+
+		Update(dt);
+
+		if (!Step(dt, accumulator, sf::Vector2f()))
+			break;
+
+		DrawCapture();
+	}
+
+	CloseCapture();
+}
+
+bool Application::Step(float dt, float& accumulator, const sf::Vector2f& mousePos)
+{
+	const float fixedDT = 1.0f / std::fmaxf(Config::Inst().Misc.PhysicsUpdateFreq, 1.0f);
+	const int deathSpiral = 12; // guarantee prevention of infinite loop
+
+	accumulator += dt;
+
+	if (m_inputRecorder.IsReplaying()) // one recorded tick per frame, as fast as they can be drawn
+	{
+		accumulator = fixedDT; // drawn as the tick ended, nothing to interpolate
+
+		if (m_inputRecorder.Update(m_inputHandler, mousePos, fixedDT))
+			FixedUpdate(m_inputRecorder.GetDeltaTime());
+	}
+	else
+	{
+		int ticks = 0;
 		while (accumulator >= fixedDT && ticks++ < deathSpiral)
 		{
 			accumulator -= fixedDT;
+
+			m_inputRecorder.Update(m_inputHandler, mousePos, fixedDT);
 			FixedUpdate(fixedDT);
 		}
+	}
 
-		float interp = accumulator / fixedDT;
-		PostUpdate(dt, interp); // interp
+	if (m_inputRecorder.IsFinished())
+		return false;
 
-		Draw();
-	}
+	float interp = accumulator / fixedDT;
+	PostUpdate(dt, interp); // interp
+
+	return true;
 }
 
 void Application::ProcessInput()
@@ -79,6 +161,7 @@ void Application::ProcessInput()
 			continue;
 
 		m_inputHandler.HandleEvent(event.value());
+
 		m_camera.HandleEvent(event.value());
 		m_window.HandleEvent(event.value());
 		m_mainState.HandleEvent(event.value());
@@ -110,8 +193,51 @@ void Application::PostUpdate(float dt, float interp)
 
 void Application::Draw()
 {
+	if (m_frameCapture.IsActive())
+	{
+		const sf::Sprite frame(DrawCapture());
+
+		m_window.Setup();
+		m_window.setView(m_window.getDefaultView());
+		m_window.draw(frame);
+		m_window.display();
+
+		return;
+	}
+
 	m_window.Setup();
 	m_window.setView(m_camera);
-	m_mainState.Draw();
+	m_mainState.Draw(m_window);
 	m_window.display();
 }
+
+const sf::Texture& Application::DrawCapture()
+{
+	sf::RenderTarget& target = m_frameCapture.GetTarget();
+
+	sf::Color clearColor = m_window.GetClearColor();
+	clearColor.a = 255; // the window clears transparent, the frames would come out see-through
+
+	target.clear(clearColor);
+	target.setView(m_camera);
+	m_mainState.Draw(target);
+
+	return m_frameCapture.Capture();
+}
+
+void Application::OpenCapture(const sf::Vector2u& size)
+{
+	m_frameCapture.Open(
+		Config::Inst().Misc.CapturePath,
+		FrameCapture::ToFormat(Config::Inst().Misc.CaptureFormat),
+		size,
+		Config::Inst().Misc.CaptureBufferSize);
+}
+
+void Application::CloseCapture()
+{
+	m_frameCapture.Close();
+
+	if (const std::string error = m_frameCapture.GetError(); !error.empty()) // frames still in flight are only written on close
+		throw std::runtime_error(error);
+}
@@ -4,16 +4,25 @@
 
 #include "Camera.h"
 #include "Window.h"
+#include "InputRecorder.h"
+#include "FrameCapture.h"
 #include "ResourceHolder.hpp"
 
 class Application
 {
 public:
-	Application(std::string name);
+	// a headless application never opens its window, nor asks for the desktop it would open on
+	//
+	Application(std::string name, bool headless = false);
 
 public:
 	void Run();
 
+	// renders every frame to the capture target within a context of its own rather than that of a
+	// window, throws if there is no capture path or nothing to stop at
+	//
+	void RunHeadless();
+
 private:
 	void ProcessInput();
 
@@ -22,12 +31,22 @@ private:
 	void FixedUpdate(float dt); // after update, before post_update
 	void PostUpdate(float dt, float interp);
 
+	// runs the ticks that are due and finishes the frame, false once the replay has finished
+	//
+	bool Step(float dt, float& accumulator, const sf::Vector2f& mousePos);
+
 	void Draw();
+	const sf::Texture& DrawCapture();
+
+	void OpenCapture(const sf::Vector2u& size);
+	void CloseCapture();
 
 private:
 	Window			m_window;
 	Camera			m_camera;
 	InputHandler	m_inputHandler;
+	InputRecorder	m_inputRecorder;
+	FrameCapture	m_frameCapture;
 	TextureHolder	m_textureHolder;
 	FontHolder		m_fontHolder;
 	MainState		m_mainState;
@@ -88,11 +88,11 @@ void Background::LoadProperties(const sf::Vector2i& size)
 		(std::uint8_t)(Config::Inst().Background.Color.z * 255.999f)) : sf::Color::White);
 }
 
-void Background::Draw(sf::RenderWindow& window) const
+void Background::Draw(sf::RenderTarget& target) const
 {
 	if (m_background.getTexture().getSize().x == 0U ||
 		m_background.getTexture().getSize().y == 0U)
 		return;
 
-	window.draw(m_background);
+	target.draw(m_background);
 }
\ No newline at end of file
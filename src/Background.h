@@ -1,6 +1,6 @@
 #pragma once
 
-#include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/Sprite.hpp>
 
 #include "ResourceHolder.hpp"
@@ -15,7 +15,7 @@ public:
 	void LoadProperties(const sf::Vector2i& size);
 
 public:
-	void Draw(sf::RenderWindow& window) const;
+	void Draw(sf::RenderTarget& target) const;
 
 private:
 	void LoadTexture(const TextureHolder& textureHolder);
@@ -0,0 +1,599 @@
+#include "Benchmark.h"
+
+#include <SFML/Graphics/VertexArray.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "BoidContainer.h"
+#include "Grid.h"
+#include "Fluid.h"
+#include "Impulse.h"
+#include "InputHandler.h"
+#include "InputRecorder.h"
+#include "PredatorContainer.h"
+#include "ObstacleField.h"
+#include "SpatialHash.h"
+#include "MainState.h"
+
+#include "CommonUtilities.hpp"
+#include "VectorUtilities.hpp"
+
+#include "Config.h"
+
+std::string Benchmark::Scenario::GetName() const
+{
+	std::ostringstream name;
+
+	name << "n=" << count
+		 << " sep=" << distances.sep
+		 << " ali=" << distances.ali
+		 << " coh=" << distances.coh
+		 << " policy=" << GetPolicyName(policy)
+		 << " turn=" << turnAtBorder
+		 << " color=" << colorFlags
+		 << " fluid=" << fluidScale;
+
+	return name.str();
+}
+
+Benchmark::Benchmark(std::string scenarioPath, std::string baselinePath)
+	: m_scenarioPath(std::move(scenarioPath))
+	, m_baselinePath(std::move(baselinePath)) {}
+
+bool Benchmark::Run()
+{
+	if (!LoadScenarios())
+		return false;
+
+	const Config original = Config::Inst();
+
+	nlohmann::json results = nlohmann::json::array();
+
+	for (const Scenario& scenario : m_scenarios)
+	{
+		const StageTimes times = RunScenario(scenario);
+
+		Config::Inst() = original;
+
+		nlohmann::json stages;
+		double total = 0.0;
+
+		for (std::size_t i = 0; i < times.size(); ++i)
+		{
+			stages[GetStageName((Stage)i)] = times[i];
+			total += times[i];
+		}
+
+		nlohmann::json entry;
+		entry["Name"]	= scenario.GetName();
+		entry["Stages"] = stages;
+		entry["Total"]	= total;
+
+		results.push_back(entry);
+	}
+
+	if (!m_replayPath.empty())
+	{
+		StageTimes times{};
+
+		try
+		{
+			times = RunReplay();
+		}
+		catch (const std::runtime_error&) // recording could not be read
+		{
+			Config::Inst() = original;
+			return false;
+		}
+
+		Config::Inst() = original;
+
+		nlohmann::json stages;
+		double total = 0.0;
+
+		for (std::size_t i = 0; i < times.size(); ++i)
+		{
+			stages[GetStageName((Stage)i)] = times[i];
+			total += times[i];
+		}
+
+		nlohmann::json entry;
+		entry["Name"]	= "replay=" + m_replayPath;
+		entry["Stages"] = stages;
+		entry["Total"]	= total;
+
+		results.push_back(entry);
+	}
+
+	nlohmann::json output;
+	output["Unit"]		= "ns/boid/tick";
+	output["Results"]	= results;
+
+	bool success = true;
+
+	std::ifstream baselineFile(m_baselinePath);
+	if (baselineFile.good())
+	{
+		const nlohmann::json baseline = nlohmann::json::parse(baselineFile, nullptr, false, true);
+
+		nlohmann::json regressions = nlohmann::json::array();
+
+		if (!baseline.is_discarded() && baseline.contains("Results"))
+			success = Compare(results, baseline["Results"], regressions);
+
+		output["Regressions"] = regressions;
+	}
+	else // first run becomes the baseline
+	{
+		std::ofstream newBaseline(m_baselinePath, std::ios::out | std::ios::trunc);
+		newBaseline << output.dump(4);
+	}
+
+	std::ofstream resultsFile(BENCHMARK_RESULTS_FILE, std::ios::out | std::ios::trunc);
+	resultsFile << output.dump(4);
+
+	return success;
+}
+
+bool Benchmark::LoadScenarios()
+{
+	std::ifstream file(m_scenarioPath);
+	if (!file.good())
+		return false;
+
+	try
+	{
+		nlohmann::json json = nlohmann::json::parse(file, nullptr, true, true);
+		auto& bench = json["Benchmark"];
+
+		m_border		= RectFloat(0.0f, 0.0f, bench["Width"], bench["Height"]);
+		m_warmupTicks	= bench["WarmupTicks"];
+		m_ticks			= std::max((int)bench["Ticks"], 1);
+		m_boidTicks		= bench["BoidTicks"];
+		m_dt			= 1.0f / std::fmaxf(bench["PhysicsUpdateFreq"], 1.0f);
+		m_threshold		= bench["Threshold"];
+		m_minDifference	= bench["MinDifference"];
+		m_replayPath	= bench["Replay"];
+
+		std::vector<std::size_t> counts = bench["Counts"];
+		std::vector<std::string> policies = bench["Policies"];
+		std::vector<bool> turnAtBorders = bench["TurnAtBorder"];
+		std::vector<std::vector<int>> colorOptions = bench["ColorOptions"];
+		std::vector<int> fluidScales = bench["FluidScales"];
+
+		std::vector<Distances> distances;
+		for (const auto& distance : bench["Distances"])
+			distances.push_back(Distances{ distance["Sep"], distance["Ali"], distance["Coh"] });
+
+		m_scenarios.clear();
+
+		for (std::size_t count : counts)
+		{
+			for (const Distances& distance : distances)
+			{
+				for (const std::string& policy : policies)
+				{
+					for (bool turnAtBorder : turnAtBorders)
+					{
+						for (const std::vector<int>& options : colorOptions)
+						{
+							for (int fluidScale : fluidScales)
+							{
+								Scenario scenario;
+								scenario.count			= count;
+								scenario.distances		= distance;
+								scenario.policy			= ToPolicy(policy);
+								scenario.turnAtBorder	= turnAtBorder;
+								scenario.fluidScale		= std::max(fluidScale, 1);
+
+								for (int option : options)
+									scenario.colorFlags |= util::Pow(2, option - 1);
+
+								m_scenarios.push_back(scenario);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	catch (nlohmann::json::parse_error) { return false; }
+	catch (nlohmann::detail::type_error e) { return false; }
+
+	return true;
+}
+
+Benchmark::StageTimes Benchmark::RunScenario(const Scenario& scenario)
+{
+	using Clock = std::chrono::steady_clock;
+
+	Config& config = Config::Inst();
+
+	config.Boids.Count					= scenario.count;
+	config.Rules.SepDistance			= scenario.distances.sep * scenario.distances.sep;
+	config.Rules.AliDistance			= scenario.distances.ali * scenario.distances.ali;
+	config.Rules.CohDistance			= scenario.distances.coh * scenario.distances.coh;
+	config.Interaction.TurnAtBorder		= scenario.turnAtBorder;
+	config.Color.Flags					= scenario.colorFlags;
+	config.Fluid.Scale					= scenario.fluidScale;
+	config.Species.clear();				// the distances of the scenario alone size the grid
+
+	util::Seed(0x5EED); // same starting positions for every run
+
+	const float minDistance = MainState::GetMinDistance();
+	const float cellSize	= MainState::GetCellSize();
+
+	Grid grid;
+	grid.Initialize(MainState::GetGridBorder(m_border, minDistance), sf::Vector2f(cellSize, cellSize));
+
+	Fluid fluid;
+	fluid.Initialize(sf::Vector2u(m_border.Size()));
+
+	BoidContainer boids(scenario.count);
+	for (std::size_t i = 0; i < scenario.count; ++i)
+	{
+		boids.Push(sf::Vector2f(
+			util::Random(0.0f, m_border.width) + m_border.left,
+			util::Random(0.0f, m_border.height) + m_border.top));
+	}
+
+	sf::VertexArray vertices(sf::PrimitiveType::Triangles, scenario.count * 6);
+
+	const InputHandler inputHandler;
+	const std::vector<Impulse> impulses;
+
+	StageTimes times{};
+
+	const int ticks		= GetTicks(scenario.count);
+	const int warmup	= std::min(m_warmupTicks, ticks);
+
+	for (int tick = 0; tick < warmup + ticks; ++tick)
+	{
+		const bool measure = (tick >= warmup);
+
+		const auto time = [&times, measure](Stage stage, auto&& func)
+			{
+				const auto start = Clock::now();
+				func();
+				const auto end = Clock::now();
+
+				if (measure)
+					times[(std::size_t)stage] += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			};
+
+		time(Stage::ResetGrid,		[&] { grid.ResetBuffers(); });
+		time(Stage::PreUpdate,		[&] { boids.PreUpdate(grid); });
+		time(Stage::UpdateCells,	[&] { boids.UpdateCells(grid); });
+		time(Stage::Flock,			[&]
+			{
+				boids.Flock(grid, scenario.policy);
+				boids.Interaction(inputHandler, sf::Vector2f(), m_dt);
+			});
+		time(Stage::Update,			[&] { boids.Update(m_border, impulses, m_dt); });
+		time(Stage::Fluid,			[&]
+			{
+				if ((config.Color.Flags & CF_Fluid) == CF_Fluid)
+					fluid.Update(m_dt);
+			});
+		time(Stage::UpdateColors,	[&] { boids.UpdateColors(m_border, fluid, nullptr, impulses); });
+		time(Stage::UpdateVertices, [&] { boids.UpdateVertices(vertices, 1.0f, scenario.policy); });
+	}
+
+	const double samples = (double)ticks * (double)std::max<std::size_t>(scenario.count, 1);
+
+	for (double& stageTime : times)
+		stageTime /= samples;
+
+	return times;
+}
+
+Benchmark::StageTimes Benchmark::RunReplay()
+{
+	using Clock = std::chrono::steady_clock;
+
+	InputRecorder recorder;
+	recorder.OpenReplay(m_replayPath); // seeds and loads the config of the session
+
+	const Config& config = Config::Inst();
+
+	// spawned in the same order as the main state so that the same random numbers end up in the
+	// same places, the obstacle mask is a texture and left out
+
+	float minDistance	= MainState::GetMinDistance();
+	float cellSize		= MainState::GetCellSize();
+
+	Grid grid;
+	grid.Initialize(MainState::GetGridBorder(m_border, minDistance), sf::Vector2f(cellSize, cellSize));
+
+	SpatialHash spatialHash;
+	spatialHash.Initialize(sf::Vector2f(cellSize, cellSize));
+
+	Fluid fluid;
+	fluid.Initialize(sf::Vector2u(m_border.Size()));
+
+	PredatorContainer predators;
+	predators.Initialize(m_border);
+	predators.Resize(config.Interaction.PredatorCount, m_border);
+
+	ObstacleField obstacles;
+	obstacles.Initialize(m_border, nullptr);
+
+	const auto spawn = [this](BoidContainer& boids, std::size_t first, std::size_t last)
+		{
+			boids.Reserve(last);
+			for (std::size_t i = first; i < last; ++i)
+			{
+				boids.Push(sf::Vector2f(
+					util::Random(0.0f, m_border.width) - m_border.left,
+					util::Random(0.0f, m_border.height) - m_border.top));
+			}
+		};
+
+	BoidContainer boids(config.Boids.Count);
+	spawn(boids, 0, config.Boids.Count);
+
+	sf::VertexArray vertices;
+	std::vector<Impulse> impulses;
+
+	sf::Vector2f mousePos, mousePosPrev;
+	sf::Vector2i fluidMousePos, fluidMousePosPrev;
+
+	StageTimes times{};
+	double samples = 0.0;
+
+	while (recorder.Update(InputHandler(), sf::Vector2f(), m_dt))
+	{
+		const float dt = recorder.GetDeltaTime();
+		const InputHandler& input = recorder.GetInput();
+
+		const auto time = [&times](Stage stage, auto&& func)
+			{
+				const auto start = Clock::now();
+				func();
+				const auto end = Clock::now();
+
+				times[(std::size_t)stage] += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			};
+
+		Config prev = config;
+		for (Rebuild rebuild : recorder.RefreshConfig(prev)) // only what changes the work of a tick
+		{
+			switch (rebuild)
+			{
+				case Rebuild::Grid:
+				{
+					minDistance = MainState::GetMinDistance();
+					cellSize	= MainState::GetCellSize();
+
+					grid.Initialize(MainState::GetGridBorder(m_border, minDistance), sf::Vector2f(cellSize, cellSize));
+					spatialHash.Initialize(sf::Vector2f(cellSize, cellSize));
+
+					predators.Initialize(m_border);
+
+					break;
+				}
+				case Rebuild::Boids:
+				{
+					if (config.Boids.Count > prev.Boids.Count)
+						spawn(boids, prev.Boids.Count, config.Boids.Count);
+					else if (boids.GetSize() > config.Boids.Count)
+						boids.Pop(boids.GetSize() - config.Boids.Count);
+
+					break;
+				}
+				case Rebuild::Species:
+				{
+					boids.Clear();
+					spawn(boids, 0, config.Boids.Count);
+
+					break;
+				}
+				case Rebuild::Predators:
+				{
+					predators.Initialize(m_border);
+					predators.Resize(config.Interaction.PredatorCount, m_border);
+
+					break;
+				}
+				case Rebuild::Obstacles:
+				{
+					obstacles.Initialize(m_border, nullptr);
+					break;
+				}
+				case Rebuild::Fluid:
+				{
+					fluid.Initialize(sf::Vector2u(m_border.Size()));
+					break;
+				}
+				default:
+					break;
+			}
+		}
+
+		const Policy policy = (boids.GetSize() <= config.Misc.PolicyThreshold) ? Policy::unseq : Policy::par_unseq;
+
+		mousePosPrev	= mousePos;
+		mousePos		= recorder.GetMousePosition();
+
+		time(Stage::Fluid, [&]
+			{
+				if ((config.Color.Flags & CF_Fluid) != CF_Fluid)
+					return;
+
+				fluidMousePosPrev	= fluidMousePos;
+				fluidMousePos		= sf::Vector2i(mousePos / (float)config.Fluid.Scale);
+
+				const sf::Vector2i amount = vu::Abs(fluidMousePos - fluidMousePosPrev);
+
+				if (amount.x > 0 || amount.y > 0)
+				{
+					fluid.StepLine(
+						fluidMousePosPrev.x, fluidMousePosPrev.y,
+						fluidMousePos.x, fluidMousePos.y,
+						amount.x, amount.y, config.Fluid.MouseStrength);
+				}
+
+				fluid.Update(dt);
+			});
+
+		const auto tick = [&](auto& cells)
+			{
+				time(Stage::Interaction, [&] // same as the interactions of the main state
+					{
+						if (input.GetKeyHeld(sf::Keyboard::Key::RAlt) && input.GetButtonHeld(sf::Mouse::Button::Middle))
+						{
+							const sf::Vector2f mouseDelta = vu::Direction(mousePosPrev, mousePos);
+							if (mouseDelta.lengthSquared() > config.Interaction.BoidAddMouseDiff)
+								boids.PushMany((std::size_t)config.Interaction.BoidAddAmount, mousePos, mouseDelta, 1.0f);
+						}
+
+						if (input.GetKeyHeld(sf::Keyboard::Key::RAlt) && input.GetKeyHeld(sf::Keyboard::Key::Delete))
+						{
+							boids.Remove(cells, mousePos, config.Interaction.BoidRemoveRadius);
+						}
+						else if (input.GetKeyHeld(sf::Keyboard::Key::Delete) && boids.GetSize() > config.Boids.Count)
+						{
+							boids.Pop(std::min(
+								boids.GetSize() - config.Boids.Count,
+								(std::size_t)config.Interaction.BoidRemoveAmount));
+						}
+
+						if (config.Impulse.Enabled && input.GetButtonPressed(sf::Mouse::Button::Left))
+							impulses.emplace_back(mousePos, config.Impulse.Speed, config.Impulse.Size, -config.Impulse.Size);
+
+						for (auto i = std::ssize(impulses) - 1; i >= 0; --i)
+						{
+							impulses[i].Update(dt);
+							if (impulses[i].GetLength() > config.Impulse.FadeDistance)
+								impulses.erase(impulses.begin() + i);
+						}
+
+						predators.Update(boids, m_border, dt);
+					});
+
+				time(Stage::ResetGrid,		[&] { cells.ResetBuffers(); });
+				time(Stage::PreUpdate,		[&] { boids.PreUpdate(cells); });
+				time(Stage::UpdateCells,	[&] { boids.UpdateCells(cells); });
+				time(Stage::Flock,			[&]
+					{
+						boids.Flock(cells, policy);
+						boids.Interaction(input, mousePos, dt);
+						boids.AvoidPredators(predators, dt, policy);
+						boids.AvoidObstacles(obstacles, dt, policy);
+						boids.GatherImpulses(cells, impulses, dt);
+					});
+			};
+
+		if (config.Misc.GridHashed)
+			tick(spatialHash);
+		else
+			tick(grid);
+
+		time(Stage::Update,			[&] { boids.Update(m_border, impulses, dt); });
+		time(Stage::UpdateColors,	[&] { boids.UpdateColors(m_border, fluid, nullptr, impulses); });
+		time(Stage::UpdateVertices, [&]
+			{
+				if (vertices.getVertexCount() < boids.GetCapacity() * 6)
+					vertices.resize(boids.GetCapacity() * 6);
+
+				boids.UpdateVertices(vertices, 1.0f, policy);
+			});
+
+		samples += (double)std::max<std::size_t>(boids.GetSize(), 1);
+	}
+
+	for (double& stageTime : times)
+		stageTime /= std::max(samples, 1.0);
+
+	return times;
+}
+
+int Benchmark::GetTicks(std::size_t count) const
+{
+	if (m_boidTicks <= 0.0 || count == 0)
+		return m_ticks;
+
+	return std::clamp((int)(m_boidTicks / (double)count), 1, m_ticks);
+}
+
+bool Benchmark::Compare(const nlohmann::json& results, const nlohmann::json& baseline, nlohmann::json& regressions) const
+{
+	std::unordered_map<std::string, const nlohmann::json*> baselineByName;
+	for (const auto& entry : baseline)
+		baselineByName[entry["Name"]] = &entry;
+
+	for (const auto& entry : results)
+	{
+		const auto it = baselineByName.find(entry["Name"]);
+		if (it == baselineByName.end()) // new scenario, nothing to compare against
+			continue;
+
+		const nlohmann::json& baseStages = (*it->second)["Stages"];
+
+		for (const auto& [stage, value] : entry["Stages"].items())
+		{
+			if (!baseStages.contains(stage))
+				continue;
+
+			const double current	= value;
+			const double previous	= baseStages[stage];
+
+			if (previous > 0.0 && current > previous * (1.0 + m_threshold) && current - previous >= m_minDifference)
+			{
+				nlohmann::json regression;
+				regression["Name"]		= entry["Name"];
+				regression["Stage"]		= stage;
+				regression["Baseline"]	= previous;
+				regression["Current"]	= current;
+				regression["Ratio"]		= current / previous;
+
+				regressions.push_back(regression);
+			}
+		}
+	}
+
+	return regressions.empty();
+}
+
+const char* Benchmark::GetStageName(Stage stage)
+{
+	switch (stage)
+	{
+		case Stage::ResetGrid:		return "ResetGrid";
+		case Stage::PreUpdate:		return "PreUpdate";
+		case Stage::UpdateCells:	return "UpdateCells";
+		case Stage::Interaction:	return "Interaction";
+		case Stage::Flock:			return "Flock";
+		case Stage::Update:			return "Update";
+		case Stage::UpdateColors:	return "UpdateColors";
+		case Stage::Fluid:			return "Fluid";
+		case Stage::UpdateVertices: return "UpdateVertices";
+		default:					return "Unknown";
+	}
+}
+
+const char* Benchmark::GetPolicyName(Policy policy)
+{
+	switch (policy)
+	{
+		case Policy::seq:		return "seq";
+		case Policy::unseq:		return "unseq";
+		case Policy::par:		return "par";
+		case Policy::par_unseq: return "par_unseq";
+		default:				return "unknown";
+	}
+}
+
+Policy Benchmark::ToPolicy(const std::string& name)
+{
+	if (name == "unseq")		return Policy::unseq;
+	if (name == "par")			return Policy::par;
+	if (name == "par_unseq")	return Policy::par_unseq;
+
+	return Policy::seq;
+}
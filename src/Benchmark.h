@@ -0,0 +1,101 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "PolicySelect.h"
+#include "Rectangle.hpp"
+
+inline constexpr const char* BENCHMARK_FILE				= "Benchmark.json";
+inline constexpr const char* BENCHMARK_BASELINE_FILE	= "BenchmarkBaseline.json";
+inline constexpr const char* BENCHMARK_RESULTS_FILE		= "BenchmarkResults.json";
+
+enum class Stage
+{
+	ResetGrid,
+	PreUpdate,
+	UpdateCells,
+	Interaction,
+	Flock,
+	Update,
+	UpdateColors,
+	Fluid,
+	UpdateVertices,
+	Count
+};
+
+// runs the simulation stages without a window for every combination of the scenario matrix, and
+// a recorded session if there is one, reports the time per boid and tick of every stage and
+// compares it against a baseline
+//
+class Benchmark
+{
+private:
+	using StageTimes = std::array<double, (std::size_t)Stage::Count>;
+
+	struct Distances
+	{
+		float sep {0.0f};
+		float ali {0.0f};
+		float coh {0.0f};
+	};
+
+	struct Scenario
+	{
+		std::size_t		count			{0};
+		Distances		distances;
+		Policy			policy			{Policy::seq};
+		bool			turnAtBorder	{false};
+		std::uint32_t	colorFlags		{0};
+		int				fluidScale		{1};
+
+		[[nodiscard]] std::string GetName() const;
+	};
+
+public:
+	Benchmark(std::string scenarioPath, std::string baselinePath);
+
+public:
+	// returns false if the scenarios could not be loaded or any stage regressed beyond the threshold,
+	// by at least the minimum difference
+	//
+	bool Run();
+
+private:
+	bool LoadScenarios();
+
+	StageTimes RunScenario(const Scenario& scenario);
+
+	// replays every tick of the recorded session with its seed and config, the boids spawn within
+	// the border of the benchmark so it should match the window that recorded the session
+	//
+	StageTimes RunReplay();
+
+	// large counts run fewer ticks so that every scenario takes about the same number of boid ticks
+	//
+	[[nodiscard]] int GetTicks(std::size_t count) const;
+
+	bool Compare(const nlohmann::json& results, const nlohmann::json& baseline, nlohmann::json& regressions) const;
+
+	static const char* GetStageName(Stage stage);
+	static const char* GetPolicyName(Policy policy);
+	static Policy ToPolicy(const std::string& name);
+
+private:
+	std::string				m_scenarioPath;
+	std::string				m_baselinePath;
+
+	std::vector<Scenario>	m_scenarios;
+	std::string				m_replayPath;
+	RectFloat				m_border;
+
+	int						m_warmupTicks	{10};
+	int						m_ticks			{60};
+	double					m_boidTicks		{0.0}; // budget of boids times ticks per scenario, none when zero
+	float					m_dt			{1.0f / 60.0f};
+	double					m_threshold		{0.1};
+	double					m_minDifference	{0.5}; // ns/boid/tick, stages that take next to nothing are timer noise
+};
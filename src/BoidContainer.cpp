@@ -8,375 +8,1421 @@
 
 #include "Config.h"
 
-BoidContainer::BoidContainer(std::size_t capacity) : m_capacity(capacity)
+BoidContainer::BoidContainer(std::size_t capacity)
 {
-	m_indices			= std::make_unique<std::uint32_t[]>(m_capacity);
+	Reallocate(capacity);
+}
+
+std::size_t BoidContainer::GetSize() const noexcept
+{
+	return m_size;
+}
+
+std::size_t BoidContainer::GetCapacity() const noexcept
+{
+	return m_capacity;
+}
+
+const sf::Vector2f* BoidContainer::GetPositions() const noexcept
+{
+	return m_positions;
+}
+const sf::Vector2f* BoidContainer::GetVelocities() const noexcept
+{
+	return m_velocities;
+}
+const std::uint16_t* BoidContainer::GetDensities() const noexcept
+{
+	return m_densities;
+}
+const std::uint32_t* BoidContainer::GetIds() const noexcept
+{
+	return m_ids;
+}
+const std::uint8_t* BoidContainer::GetSpecies() const noexcept
+{
+	return m_species;
+}
+std::uint32_t BoidContainer::GetIndex(std::uint32_t id) const noexcept
+{
+	return (id < m_slots.size()) ? m_slots[id] : UINT32_MAX;
+}
+
+std::size_t BoidContainer::GetSpeciesCount() const noexcept
+{
+	return m_segments.size();
+}
+SpeciesSegment BoidContainer::GetSegment(std::size_t species) const noexcept
+{
+	return SpeciesSegment
+	{ 
+		m_segments[species], 
+		(species + 1 < m_segments.size()) ? m_segments[species + 1] : m_size 
+	};
+}
+
+void BoidContainer::Push(const sf::Vector2f& pos)
+{
+	const std::uint8_t species = RandomSpecies();
+
+	Push(pos, sf::Vector2f(
+		util::Random(-1.0f, 1.0f),
+		util::Random(-1.0f, 1.0f)) * GetFlockRules(species).speedMax, species);
+}
+
+void BoidContainer::Push(const sf::Vector2f& pos, const sf::Vector2f& velocity)
+{
+	Push(pos, velocity, RandomSpecies());
+}
+
+void BoidContainer::Push(const sf::Vector2f& pos, const sf::Vector2f& velocity, std::uint8_t species)
+{
+	if (m_size == m_capacity)
+		Reallocate(GetGrowth(m_size + 1));
+
+	const std::uint32_t index = OpenSlot(species);
+	m_impulsesGathered = false; // boids may have moved between slots
+
+	std::uint32_t id = (std::uint32_t)m_slots.size();
+	if (!m_freeIds.empty())
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	else
+	{
+		m_slots.emplace_back();
+	}
+
+	m_slots[id] = index;
+	m_ids[index] = id;
+
+	m_indices[m_size] = index;
+	m_ranks[index] = (std::uint32_t)m_size;
+	m_cellIndices[index] = UINT64_MAX; // sorts last until binned
+	m_species[index] = species;
+
+	m_prevVelocities[index] = m_velocities[index] = velocity;
+
+	m_prevPositions[index] = m_positions[index] = pos;
+
+	m_cycleTimes[index]		= Config::Inst().Cycle.Random ? util::Random(0.0f, 1.0f) : 0.0f;
+	m_densityTimes[index]	= 0.0f;
+	m_densities[index]		= 0;
+	m_colors[index]			= sf::Color::Black;
+	m_teleported[index]		= false;
+
+	++m_size;
+}
+
+void BoidContainer::PushMany(std::size_t count, const sf::Vector2f& pos, const sf::Vector2f& direction, float spread)
+{
+	if (m_size + count > m_capacity)
+		Reallocate(GetGrowth(m_size + count));
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Push(pos, vu::RotatePoint(direction, {}, util::Random(-spread, spread)));
+	}
+}
+
+void BoidContainer::Pop(std::size_t count)
+{
+	assert(count > 0); // pop nothing ???
+
+	count = std::min(count, m_size);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		// take from the species by share so that they keep their proportions
+
+		const std::size_t species = std::min<std::size_t>(RandomSpecies(), GetSpeciesCount() - 1);
+		const SpeciesSegment segment = GetSegment(species);
+
+		RemoveAt((std::uint32_t)((segment.start != segment.end) ? segment.end : m_size) - 1);
+	}
+}
+
+void BoidContainer::Clear()
+{
+	m_size = 0;
+	m_binnedSize = 0;
+	m_orderChanged = true;
+	m_impulsesGathered = false;
+
+	m_segments.clear();
+	m_slots.clear();
+	m_freeIds.clear();
+	m_teleportedIds.clear();
+}
+
+bool BoidContainer::Remove(std::uint32_t id)
+{
+	if (id >= m_slots.size() || m_slots[id] == UINT32_MAX)
+		return false;
+
+	RemoveAt(m_slots[id]);
+
+	return true;
+}
+
+template<class G>
+std::size_t BoidContainer::Remove(const G& grid, const sf::Vector2f& center, float radius)
+{
+	const float radiusSqr = radius * radius;
+
+	const auto inside = [this, &center, radiusSqr](std::size_t index)
+		{
+			return (m_positions[index] - center).lengthSquared() <= radiusSqr;
+		};
+
+	m_removeIds.clear();
+
+	if (m_orderChanged)
+	{
+		for (std::size_t i = 0; i < m_size; ++i)
+		{
+			if (inside(i))
+				m_removeIds.push_back(m_ids[i]);
+		}
+	}
+	else
+	{
+		// boids have moved since they were binned, by at most the largest speed of a tick, which may
+		// well span several cells, so the radius is padded by as much
+
+		const float padded = radius + m_maxStep;
+
+		const sf::Vector2f min = grid.RelativePos(center - sf::Vector2f(padded, padded));
+		const sf::Vector2f max = grid.RelativePos(center + sf::Vector2f(padded, padded));
+
+		for (int y = (int)std::floorf(min.y); y <= (int)std::floorf(max.y); ++y)
+		{
+			for (int x = (int)std::floorf(min.x); x <= (int)std::floorf(max.x); ++x)
+			{
+				const GridCell cell = grid.GetCell(grid.AtPos(x, y));
+
+				for (int i = cell.start; i < cell.end; ++i)
+				{
+					if (inside(m_indices[i]))
+						m_removeIds.push_back(m_ids[m_indices[i]]);
+				}
+			}
+		}
+
+		for (std::size_t i = m_binnedSize; i < m_size; ++i) // pushed after the cells were built, last in the order
+		{
+			if (inside(m_indices[i]))
+				m_removeIds.push_back(m_ids[m_indices[i]]);
+		}
+
+		for (const std::uint32_t id : m_teleportedIds) // binned at the opposite edge
+		{
+			const std::uint32_t index = GetIndex(id);
+
+			if (index != UINT32_MAX && inside(index))
+				m_removeIds.push_back(id);
+		}
+	}
+
+	std::size_t removed = 0;
+	for (std::uint32_t id : m_removeIds)
+	{
+		removed += Remove(id); // cells may be visited twice when the grid wraps
+	}
+
+	return removed;
+}
+
+void BoidContainer::RemoveAt(std::uint32_t index)
+{
+	const std::uint32_t last = (std::uint32_t)m_size - 1;
+	const std::uint8_t species = m_species[index];
+
+	// fill its place in the order with the last in the order, which is then out of place and is
+	// rebinned as if it were new
+
+	const std::uint32_t rank = m_ranks[index];
+	const std::uint32_t tail = m_indices[last];
+
+	m_indices[rank] = tail;
+	m_ranks[tail]	= rank;
+
+	if (tail != index)
+		m_cellIndices[tail] = UINT64_MAX;
+
+	m_slots[m_ids[index]] = UINT32_MAX;
+	m_freeIds.push_back(m_ids[index]);
+
+	// fill its place in the streams with the last boid of its species, the place that leaves is then
+	// filled with the last boid of the next species and so on to keep every species contiguous
+
+	std::uint32_t hole = index;
+
+	for (std::size_t s = species; s < m_segments.size(); ++s)
+	{
+		const std::uint32_t end = (s + 1 < m_segments.size()) ? m_segments[s + 1] : (std::uint32_t)m_size;
+
+		MoveSlot(end - 1, hole);
+		hole = end - 1;
+
+		if (s + 1 < m_segments.size())
+			--m_segments[s + 1];
+	}
+
+	--m_size;
+	m_orderChanged = true;
+	m_impulsesGathered = false;
+
+	// only give memory back well below the capacity so that alternating between adding and removing
+	// boids does not reallocate every time
+
+	if (m_capacity > MIN_CAPACITY && m_size < m_capacity / SHRINK)
+		Reallocate(std::max(m_size * GROWTH, MIN_CAPACITY));
+}
+
+void BoidContainer::Reallocate(std::size_t capacity)
+{
+	// one allocation for all streams, left uninitialized since every stream is written before it
+	// is read, each stream starts on and is padded to its own cache line to avoid false sharing
+
+	std::size_t bytes = 0;
+	ForEachStream([&]<typename T>(T*&)
+		{
+			bytes += GetStreamSize<T>(capacity);
+		});
+
+	std::unique_ptr<std::byte[], ArenaDeleter> arena(
+		static_cast<std::byte*>(::operator new[](bytes, std::align_val_t(ALIGNMENT))));
+
+	const std::size_t count = std::min(m_size, capacity);
+
+	std::byte* offset = arena.get();
+	ForEachStream([&]<typename T>(T*& ptr)
+		{
+			T* stream = reinterpret_cast<T*>(offset);
+
+			if (ptr != nullptr)
+				std::copy(ptr, ptr + count, stream);
+
+			ptr = stream;
+			offset += GetStreamSize<T>(capacity);
+		});
+
+	m_arena		= std::move(arena);
+	m_capacity	= capacity;
+}
+
+void BoidContainer::Reserve(std::size_t capacity)
+{
+	if (capacity > m_capacity) // Only reserve size if the given size is larger than current capacity
+		Reallocate(capacity);
+}
+
+std::size_t BoidContainer::GetGrowth(std::size_t required) const noexcept
+{
+	return std::max({ required, m_capacity * GROWTH, MIN_CAPACITY });
+}
+
+template<class G>
+void BoidContainer::PreUpdate(const G& grid)
+{
+	// the state of the last tick becomes the previous state, the current streams are left stale and
+	// are overwritten by Flock and Update, everything in between reads the previous state
+
+	std::swap(m_prevVelocities, m_velocities);
+	std::swap(m_prevPositions, m_positions);
+
+	m_cellChanges = 0;
+	m_firstMoved = m_size;
+	m_impulsesGathered = false;
+	m_relativeScale = grid.GetContDims() / RELATIVE_MAX;
+
+	for (std::size_t i = 0; i < m_size; ++i)
+	{
+		const sf::Vector2f gridCellRaw		= grid.RelativePos(m_prevPositions[i]);
+		const sf::Vector2i gridCell			= sf::Vector2i(gridCellRaw);
+		const sf::Vector2f gridCellOverflow = gridCellRaw - sf::Vector2f(gridCell);
+
+		const std::uint64_t cellIndex = (std::uint64_t)grid.AtPos(gridCell);
+
+		const bool moved = (cellIndex != m_cellIndices[i]);
+
+		m_cellMoved[i]					= moved;
+		m_rebinIndices[m_cellChanges]	= (std::uint32_t)i; // kept only when moved
+		m_cellChanges					+= moved;
+
+		if (moved)
+			m_firstMoved = std::min<std::size_t>(m_firstMoved, m_ranks[i]);
+
+		m_relativePositions[i]	= sf::Vector2<std::uint16_t>(
+			(std::uint16_t)(std::clamp(gridCellOverflow.x, 0.0f, 1.0f) * RELATIVE_MAX + 0.5f),
+			(std::uint16_t)(std::clamp(gridCellOverflow.y, 0.0f, 1.0f) * RELATIVE_MAX + 0.5f));
+		m_cellIndices[i]		= cellIndex;
+	}
+}
+
+void BoidContainer::Sort()
+{
+	std::sort(m_indices, m_indices + m_size,
+		[this](std::uint32_t i0, std::uint32_t i1)
+		{
+			return m_cellIndices[i0] < m_cellIndices[i1];
+		});
+}
+
+void BoidContainer::UpdateCells(Grid& grid)
+{
+	if (CanRebin())
+	{
+		Rebin();
+
+		// order is already sorted, only the occupied cells are set and the rest are left empty
+
+		std::size_t start = 0;
+		for (std::size_t i = 1; i <= m_size; ++i)
+		{
+			if (i == m_size || m_cellIndices[m_indices[i]] != m_cellIndices[m_indices[start]])
+			{
+				grid.Set((int)m_cellIndices[m_indices[start]], (int)start, (int)i);
+				start = i;
+			}
+		}
+
+		m_binnedSize	= m_size;
+		m_orderChanged	= false;
+
+		return;
+	}
+
+	// counting sort, linear in boids and cells and leaves the boids in a cell in stable order
+
+	for (std::size_t i = 0; i < m_size; ++i)
+	{
+		grid.Insert((int)m_cellIndices[i]);
+	}
+
+	grid.Scan();
+
+	for (std::size_t i = m_size; i-- > 0;)
+	{
+		const int rank = grid.Place((int)m_cellIndices[i]);
+
+		m_indices[rank] = (std::uint32_t)i;
+		m_ranks[i]		= (std::uint32_t)rank;
+	}
+
+	m_binnedSize	= m_size;
+	m_orderChanged	= false;
+}
+
+void BoidContainer::UpdateCells(SpatialHash& grid)
+{
+	m_binnedSize	= m_size;
+	m_orderChanged	= false;
+
+	if (m_size == 0)
+		return;
+
+	if (CanRebin())
+		Rebin();
+	else
+		Sort();
+
+	grid.SetStartIndex(m_cellIndices[m_indices[0]], 0);
+	m_ranks[m_indices[0]] = 0;
+
+	for (std::size_t i = 1; i < m_size; ++i)
+	{
+		m_ranks[m_indices[i]] = (std::uint32_t)i;
+
+		const std::uint64_t cellIndex	= m_cellIndices[m_indices[i]];
+		const std::uint64_t otherIndex	= m_cellIndices[m_indices[i - 1]];
+
+		if (otherIndex != cellIndex)
+		{
+			grid.SetStartIndex(cellIndex, (int)i);
+			grid.SetEndIndex(otherIndex, (int)i);
+		}
+	}
+
+	grid.SetEndIndex(m_cellIndices[m_indices[m_size - 1]], (int)m_size);
+}
+
+bool BoidContainer::CanRebin() const
+{
+	return Config::Inst().Misc.GridIncremental && m_cellChanges <= m_size / 8; // otherwise cheaper to rebuild
+}
+
+void BoidContainer::Rebin()
+{
+	// the moved boids were collected by PreUpdate, the order ahead of the first of them is left as
+	// is and they are pulled out of the rest, the remaining are still sorted
+
+	std::size_t kept = m_firstMoved;
+	const std::size_t moved = m_cellChanges;
+
+	for (std::size_t i = m_firstMoved; i < m_size; ++i)
+	{
+		const std::uint32_t index = m_indices[i];
+
+		if (!m_cellMoved[index])
+		{
+			m_ranks[index] = (std::uint32_t)kept;
+			m_indices[kept++] = index;
+		}
+	}
+
+	std::sort(m_rebinIndices, m_rebinIndices + moved,
+		[this](std::uint32_t i0, std::uint32_t i1)
+		{
+			return m_cellIndices[i0] < m_cellIndices[i1];
+		});
+
+	// merge them back in from the end so that it can be done in place
+
+	std::size_t i = kept;
+	std::size_t j = moved;
+	std::size_t k = m_size;
+
+	while (j > 0)
+	{
+		if (i > 0 && m_cellIndices[m_indices[i - 1]] > m_cellIndices[m_rebinIndices[j - 1]])
+			m_indices[--k] = m_indices[--i];
+		else
+			m_indices[--k] = m_rebinIndices[--j];
+
+		m_ranks[m_indices[k]] = (std::uint32_t)k;
+	}
+}
+
+void BoidContainer::Interaction(const InputHandler& inputHandler, const sf::Vector2f& mousePos, float dt)
+{
+	const bool holdLeft		= inputHandler.GetButtonHeld(sf::Mouse::Button::Left);
+	const bool holdRight	= inputHandler.GetButtonHeld(sf::Mouse::Button::Right);
+
+	if (Config::Inst().Interaction.SteerEnabled && (holdLeft || holdRight))
+	{
+		for (std::size_t s = 0; s < GetSpeciesCount(); ++s) // limits are constant over a segment
+		{
+			const SpeciesSegment segment = GetSegment(s);
+			const FlockRules rules = GetFlockRules(s);
+
+			for (std::size_t i = segment.start; i < segment.end; ++i)
+			{
+				sf::Vector2f dir = vu::Direction(m_prevPositions[i], mousePos);
+
+				const float factor = holdLeft ? 1.0f :
+					(holdRight ? -1.0f : 0.0f);
+
+				const float lengthOpt = vu::DistanceOpt(dir);
+				const float weight = 1.0f / (std::sqrtf(lengthOpt) + FLT_EPSILON);
+
+				SteerTowards(m_velocities[i], m_prevVelocities[i], dir, lengthOpt, Config::Inst().Interaction.SteerTowardsFactor * weight * factor * dt, rules);
+			}
+		}
+	}
+	else if (Config::Inst().Interaction.PredatorEnabled)
+	{
+		for (std::size_t s = 0; s < GetSpeciesCount(); ++s)
+		{
+			const SpeciesSegment segment = GetSegment(s);
+			const FlockRules rules = GetFlockRules(s);
+
+			for (std::size_t i = segment.start; i < segment.end; ++i)
+			{
+				sf::Vector2f dir = vu::Direction(m_prevPositions[i], mousePos);
+
+				float lengthSqr = dir.lengthSquared();
+				if (lengthSqr <= Config::Inst().Interaction.PredatorDistance)
+				{
+					float weight = 1.0f / (std::sqrtf(lengthSqr / (Config::Inst().Interaction.PredatorDistance + FLT_EPSILON)) + FLT_EPSILON);
+					SteerTowards(m_velocities[i], m_prevVelocities[i], dir, -Config::Inst().Interaction.PredatorFactor * weight * dt, rules);
+				}
+			}
+		}
+	}
+}
+
+void BoidContainer::AvoidPredators(const PredatorContainer& predators, float dt, Policy policy)
+{
+	if (predators.GetSize() == 0)
+		return;
+
+	const float distance	= Config::Inst().Interaction.PredatorDistance;
+	const float factor		= Config::Inst().Interaction.PredatorFactor;
+
+	PolicySelect([&](auto& pol)
+		{
+			std::for_each(pol, m_indices, m_indices + m_size, // sorted by cell, neighbouring boids look up the same predator cells
+				[&](std::uint32_t i)
+				{
+					const FlockRules& rules = m_speciesRules[m_species[i]]; // species mix in cell order, rules are from this tick's flock
+
+					predators.ForEachNear(m_prevPositions[i], 
+						[&](const sf::Vector2f& predator)
+						{
+							sf::Vector2f dir = vu::Direction(m_prevPositions[i], predator);
+
+							float lengthSqr = dir.lengthSquared();
+							if (lengthSqr <= distance)
+							{
+								float weight = 1.0f / (std::sqrtf(lengthSqr / (distance + FLT_EPSILON)) + FLT_EPSILON);
+								SteerTowards(m_velocities[i], m_prevVelocities[i], dir, -factor * weight * dt, rules);
+							}
+						});
+				});
+		}, policy);
+}
+
+void BoidContainer::AvoidObstacles(const ObstacleField& obstacles, float dt, Policy policy)
+{
+	if (obstacles.IsEmpty())
+		return;
+
+	const float distance	= Config::Inst().Obstacles.Distance;
+	const float factor		= Config::Inst().Obstacles.Factor;
+
+	PolicySelect([&](auto& pol)
+		{
+			std::for_each(pol, m_indices, m_indices + m_size,
+				[&](std::uint32_t i)
+				{
+					sf::Vector2f gradient;
+					const float signedDistance = obstacles.Sample(m_prevPositions[i], gradient);
+
+					if (signedDistance >= distance || gradient.lengthSquared() < FLT_EPSILON)
+						return;
+
+					const float weight = 1.0f - std::max(signedDistance, 0.0f) / distance; // full within obstacles
+					SteerTowards(m_velocities[i], m_prevVelocities[i], gradient, factor * weight * dt, m_speciesRules[m_species[i]]);
+				});
+		}, policy);
+}
+
+template<class G>
+void BoidContainer::GatherImpulses(const G& grid, const std::vector<Impulse>& impulses, float dt)
+{
+	const Config& config = Config::Inst();
+
+	m_impulsesGathered = false;
+
+	if (impulses.empty() || (config.Impulse.Force == 0.0f && config.Impulse.Colors.empty()))
+		return;
+
+	if (m_orderChanged || m_binnedSize != m_size) // cells no longer match the boids
+		return;
+
+	m_impulseOffsets.clear();
+	m_impulseBoids.clear();
+
+	// boids were binned at their previous position and are tested at their next, which is at most
+	// the largest speed of a tick away, boids that teleport at the border can be missed for a tick
+
+	const float padding = m_maxRules.speedMax * dt;
+	const sf::Vector2f cellDims = grid.GetContDims();
+
+	for (const Impulse& impulse : impulses)
+	{
+		m_impulseOffsets.push_back((std::uint32_t)m_impulseBoids.size());
+
+		const float percentage	= impulse.GetLength() / config.Impulse.FadeDistance;
+		const float size		= impulse.GetSize() * (1.0f - percentage);
+
+		if (size < 0.0f) // faded out, touches no boids
+			continue;
+
+		const float inner = std::max(impulse.GetLength() - size - padding, 0.0f);
+		const float outer = impulse.GetLength() + size + padding;
+
+		const sf::Vector2f center = grid.RelativePos(impulse.GetPosition());
+
+		int minX = (int)std::floorf(center.x - outer / cellDims.x);
+		int maxX = (int)std::floorf(center.x + outer / cellDims.x);
+		int minY = (int)std::floorf(center.y - outer / cellDims.y);
+		int maxY = (int)std::floorf(center.y + outer / cellDims.y);
+
+		if constexpr (std::is_same_v<G, Grid>) // cells beyond would wrap around onto the ones within
+		{
+			minX = std::max(minX, 0); maxX = std::min(maxX, grid.GetWidth() - 1);
+			minY = std::max(minY, 0); maxY = std::min(maxY, grid.GetHeight() - 1);
+		}
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			const float y0 = ((float)y - center.y) * cellDims.y;
+			const float y1 = y0 + cellDims.y;
+
+			const float nearY	= (y0 > 0.0f) ? y0 : (y1 < 0.0f ? y1 : 0.0f);
+			const float farY	= std::max(std::abs(y0), std::abs(y1));
+
+			for (int x = minX; x <= maxX; ++x)
+			{
+				const float x0 = ((float)x - center.x) * cellDims.x;
+				const float x1 = x0 + cellDims.x;
+
+				const float nearX	= (x0 > 0.0f) ? x0 : (x1 < 0.0f ? x1 : 0.0f);
+				const float farX	= std::max(std::abs(x0), std::abs(x1));
+
+				// the cell intersects the annulus when its closest point is within the outer radius
+				// and its farthest point is beyond the inner radius
+
+				if (nearX * nearX + nearY * nearY > outer * outer || farX * farX + farY * farY < inner * inner)
+					continue;
+
+				const GridCell cell = grid.GetCell(grid.AtPos(x, y));
+
+				for (int j = cell.start; j < cell.end; ++j)
+					m_impulseBoids.push_back(m_indices[j]);
+			}
+		}
+	}
+
+	m_impulseOffsets.push_back((std::uint32_t)m_impulseBoids.size());
+	m_impulsesGathered = true;
+}
+
+std::uint32_t BoidContainer::OpenSlot(std::uint8_t species)
+{
+	while (m_segments.size() <= species) // new species start out empty at the end
+		m_segments.push_back((std::uint32_t)m_size);
+
+	std::uint32_t hole = (std::uint32_t)m_size;
+
+	for (std::size_t s = m_segments.size() - 1; s > species; --s)
+	{
+		const std::uint32_t first = m_segments[s];
+
+		MoveSlot(first, hole);
+		hole = first;
+
+		++m_segments[s];
+	}
+
+	return hole;
+}
+
+void BoidContainer::MoveSlot(std::uint32_t from, std::uint32_t to)
+{
+	if (from == to)
+		return;
+
+	ForEachBoidStream([from, to]<typename T>(T*& ptr)
+		{
+			ptr[to] = ptr[from];
+		});
+
+	// keeps its place in the order, which therefore stays sorted
+
+	m_indices[m_ranks[to]]	= to;
+	m_slots[m_ids[to]]		= to;
+}
+
+std::uint8_t BoidContainer::RandomSpecies()
+{
+	const Config& config = Config::Inst();
+
+	float share = util::Random(0.0f, 1.0f);
+
+	for (std::size_t i = config.Species.size(); i > 0; --i) // the first species takes what is left
+	{
+		share -= config.Species[i - 1].Share;
+
+		if (share < 0.0f)
+			return (std::uint8_t)i;
+	}
+
+	return 0;
+}
+
+BoidContainer::FlockRules BoidContainer::GetFlockRules(std::size_t species)
+{
+	const Config& config = Config::Inst();
+
+	FlockRules rules;
+
+	if (species == 0 || species > config.Species.size())
+	{
+		rules.cohDistance	= config.Rules.CohDistance;
+		rules.aliDistance	= config.Rules.AliDistance;
+		rules.sepDistance	= config.Rules.SepDistance;
+		rules.cohWeight		= config.Rules.CohWeight;
+		rules.aliWeight		= config.Rules.AliWeight;
+		rules.sepWeight		= config.Rules.SepWeight;
+		rules.avoidWeight	= config.Rules.AvoidWeight;
+		rules.speedMin		= config.Boids.SpeedMin;
+		rules.speedMax		= config.Boids.SpeedMax;
+		rules.steerMax		= config.Boids.SteerMax;
+	}
+	else
+	{
+		const SpeciesConfig& sc = config.Species[species - 1];
+
+		rules.cohDistance	= sc.CohDistance;
+		rules.aliDistance	= sc.AliDistance;
+		rules.sepDistance	= sc.SepDistance;
+		rules.cohWeight		= sc.CohWeight;
+		rules.aliWeight		= sc.AliWeight;
+		rules.sepWeight		= sc.SepWeight;
+		rules.avoidWeight	= sc.AvoidWeight;
+		rules.speedMin		= sc.SpeedMin;
+		rules.speedMax		= sc.SpeedMax;
+		rules.steerMax		= sc.SteerMax;
+	}
+
+	rules.maxDistance = std::max({ rules.cohDistance, rules.aliDistance, rules.sepDistance });
+
+	rules.speedInv = (rules.speedMax == rules.speedMin) ? 1.0f
+		: (1.0f / (rules.speedMax - rules.speedMin));
+
+	rules.cosFOV	= std::cosf(config.Boids.ViewAngle); // view angle is half of the field of view
+	rules.fullFOV	= config.Boids.ViewAngle >= vu::PI<>;
+
+	return rules;
+}
+
+void BoidContainer::UpdateRules()
+{
+	m_speciesRules.resize(m_segments.size());
+	m_maxRules = FlockRules{};
+
+	for (std::size_t i = 0; i < m_speciesRules.size(); ++i)
+	{
+		const FlockRules rules = GetFlockRules(i);
+
+		m_maxRules.cohDistance = std::max(m_maxRules.cohDistance, rules.cohDistance);
+		m_maxRules.aliDistance = std::max(m_maxRules.aliDistance, rules.aliDistance);
+		m_maxRules.sepDistance = std::max(m_maxRules.sepDistance, rules.sepDistance);
+		m_maxRules.maxDistance = std::max(m_maxRules.maxDistance, rules.maxDistance);
+		m_maxRules.speedMax = std::max(m_maxRules.speedMax, rules.speedMax);
+
+		m_speciesRules[i] = rules;
+	}
+}
+
+__forceinline void BoidContainer::AccumulatePair(
+	FlockForces& forces, const FlockRules& rules, 
+	const sf::Vector2f& dir, float distanceSqr, 
+	const sf::Vector2f& otherVelocity, const sf::Vector2f& firstHeading, 
+	bool testCohesion, bool testAlignment, bool testSeparation)
+{
+	const bool withinCohesion	= testCohesion && distanceSqr < rules.cohDistance;
+	const bool withinAlignment	= testAlignment && distanceSqr < rules.aliDistance;
+
+	const auto inView = [&]() // compares cosines rather than angles, avoids the arctangent
+		{
+			return rules.fullFOV || dir.dot(firstHeading) > rules.cosFOV * std::sqrtf(distanceSqr);
+		};
+
+	const std::uint8_t flag = (static_cast<std::uint8_t>(withinCohesion) | static_cast<std::uint8_t>(withinAlignment) << 1);
+
+	switch (flag)
+	{
+		[[unlikely]] case 1U: // cohesion
+		{
+			const bool withinFOV = inView();
+
+			forces.coh += dir * (float)withinFOV; // Head towards center of boids
+			forces.cohCount += withinFOV;
+
+			break; 
+		}
+		[[unlikely]] case 2U: // alignment
+		{
+			const bool withinFOV = inView();
+
+			forces.ali += otherVelocity * (float)withinFOV; // Align with every boids velocity
+			forces.aliCount += withinFOV;
+
+			break;
+		}
+		[[likely]] case 3U: // both
+		{
+			const bool withinFOV = inView();
+
+			forces.coh += dir * (float)withinFOV;
+			forces.cohCount += withinFOV;
+
+			forces.ali += otherVelocity * (float)withinFOV;
+			forces.aliCount += withinFOV;
+
+			break;
+		}
+	}
+
+	if (testSeparation && distanceSqr < rules.sepDistance)
+	{
+		forces.sep += -dir / (distanceSqr ? distanceSqr : FLT_EPSILON);
+		++forces.sepCount;
+	}
+}
+
+__forceinline void BoidContainer::AccumulateAvoid(FlockForces& forces, const FlockRules& rules, const sf::Vector2f& dir, float distanceSqr)
+{
+	if (distanceSqr < rules.sepDistance)
+	{
+		forces.avoid += -dir / (distanceSqr ? distanceSqr : FLT_EPSILON);
+		++forces.avoidCount;
+	}
+}
+
+__forceinline void BoidContainer::AccumulateSymmetric(
+	FlockForces& lhsForces, FlockForces& rhsForces, const FlockRules& rules, 
+	const sf::Vector2f& dir, float distanceSqr, 
+	const sf::Vector2f& lhsVelocity, const sf::Vector2f& rhsVelocity, const sf::Vector2f& lhsHeading)
+{
+	if (distanceSqr < rules.sepDistance)
+	{
+		const sf::Vector2f force = -dir / (distanceSqr ? distanceSqr : FLT_EPSILON);
+
+		lhsForces.sep += force;
+		rhsForces.sep -= force;
+
+		++lhsForces.sepCount;
+		++rhsForces.sepCount;
+	}
+
+	const bool withinCohesion	= distanceSqr < rules.cohDistance;
+	const bool withinAlignment	= distanceSqr < rules.aliDistance;
+
+	if (!withinCohesion && !withinAlignment)
+		return;
+
+	const float distance = rules.fullFOV ? 0.0f : std::sqrtf(distanceSqr);
+
+	const bool lhsView = rules.fullFOV || dir.dot(lhsHeading) > rules.cosFOV * distance;
+	const bool rhsView = rules.fullFOV || -dir.dot(vu::Normalize(rhsVelocity)) > rules.cosFOV * distance;
+
+	if (withinCohesion)
+	{
+		lhsForces.coh += dir * (float)lhsView;
+		lhsForces.cohCount += lhsView;
+
+		rhsForces.coh -= dir * (float)rhsView;
+		rhsForces.cohCount += rhsView;
+	}
+
+	if (withinAlignment)
+	{
+		lhsForces.ali += rhsVelocity * (float)lhsView;
+		lhsForces.aliCount += lhsView;
+
+		rhsForces.ali += lhsVelocity * (float)rhsView;
+		rhsForces.aliCount += rhsView;
+	}
+}
+
+void BoidContainer::ApplyForces(std::uint32_t lhs, const FlockRules& rules, const FlockForces& forces)
+{
+	sf::Vector2f velocity = m_prevVelocities[lhs]; // every boid passes through here, starts the velocity of this tick
+
+	if (forces.cohCount)	velocity += SteerAt(m_prevVelocities[lhs], vu::Normalize(forces.coh, rules.speedMax), rules.steerMax) * rules.cohWeight;
+	if (forces.aliCount)	velocity += SteerAt(m_prevVelocities[lhs], vu::Normalize(forces.ali / (float)forces.aliCount, rules.speedMax), rules.steerMax) * rules.aliWeight;
+	if (forces.sepCount)	velocity += SteerAt(m_prevVelocities[lhs], vu::Normalize(forces.sep / (float)forces.sepCount, rules.speedMax), rules.steerMax) * rules.sepWeight;
+	if (forces.avoidCount)	velocity += SteerAt(m_prevVelocities[lhs], vu::Normalize(forces.avoid / (float)forces.avoidCount, rules.speedMax), rules.steerMax) * rules.avoidWeight;
+
+	m_velocities[lhs] = velocity;
+
+	m_densities[lhs] = (std::uint16_t)std::min(std::max({ forces.cohCount, forces.aliCount, forces.sepCount }), (std::uint32_t)UINT16_MAX);
+}
+
+template<class G>
+void BoidContainer::Flock(const G& grid, Policy policy)
+{
+	UpdateRules();
+
+	if constexpr (std::is_same_v<G, Grid>)
+	{
+		if (Config::Inst().Misc.FlockSymmetric)
+		{
+			FlockSymmetric(grid, policy);
+			return;
+		}
+	}
+
+	if (Config::Inst().Misc.FlockTiled)
+	{
+		FlockTiled(grid, policy);
+		return;
+	}
+
+	PolicySelect([&](auto& pol)
+		{
+			std::for_each(pol, m_indices, m_indices + m_size,
+				[&](const std::uint32_t& lhs)
+				{
+					PrefetchFlock(grid, (std::size_t)(&lhs - m_indices) + PREFETCH_DISTANCE);
+
+					FlockForces forces;
+
+					const std::uint8_t species			= m_species[lhs];
+					const FlockRules& rules				= m_speciesRules[species];
+
+					const sf::Vector2f firstPos			= m_prevPositions[lhs];
+					const sf::Vector2f firstRelative	= GetRelative(lhs);
+					const sf::Vector2f firstHeading		= vu::Normalize(m_prevVelocities[lhs]);
+
+					const sf::Vector2f cellDims			= grid.GetContDims();
+					const sf::Vector2f gridCellRaw		= grid.RelativePos(firstPos);
+					const sf::Vector2i gridCell			= sf::Vector2i(gridCellRaw);
+
+					// every rule only searches the cells whose closest point is within its radius, with cells
+					// sized after separation it only ends up testing the closest ring of cells
+
+					int minX, maxX, minY, maxY;
+
+					if (grid.GetStencil() == GridStencil::Quadrant)
+					{
+						const sf::Vector2f gridCellOverflow = gridCellRaw - sf::Vector2f(gridCell);
+
+						const int x = (gridCellOverflow.x > 0.5f ? 1 : -1);
+						const int y = (gridCellOverflow.y > 0.5f ? 1 : -1);
+
+						minX = std::min(0, x); maxX = std::max(0, x);
+						minY = std::min(0, y); maxY = std::max(0, y);
+					}
+					else
+					{
+						minX = minY = -GetRings(grid, rules);
+						maxX = maxY =  GetRings(grid, rules);
+					}
+
+					for (int dy = minY; dy <= maxY; ++dy)
+					{
+						const float edgeY = 
+							(dy > 0) ? (float)dy * cellDims.y - firstRelative.y : 
+							(dy < 0) ? firstRelative.y - (float)(dy + 1) * cellDims.y : 0.0f;
+
+						for (int dx = minX; dx <= maxX; ++dx)
+						{
+							const float edgeX = 
+								(dx > 0) ? (float)dx * cellDims.x - firstRelative.x : 
+								(dx < 0) ? firstRelative.x - (float)(dx + 1) * cellDims.x : 0.0f;
 
-	m_positions			= std::make_unique<sf::Vector2f[]>(m_capacity);
-	m_prevPositions		= std::make_unique<sf::Vector2f[]>(m_capacity);
-	m_velocities		= std::make_unique<sf::Vector2f[]>(m_capacity);
-	m_prevVelocities	= std::make_unique<sf::Vector2f[]>(m_capacity);
-	m_relativePositions = std::make_unique<sf::Vector2f[]>(m_capacity);
-	m_colors			= std::make_unique<sf::Vector3f[]>(m_capacity);
+							const float cellDistanceSqr = edgeX * edgeX + edgeY * edgeY;
 
-	m_speeds			= std::make_unique<float[]>(m_capacity);
-	m_angles			= std::make_unique<float[]>(m_capacity);
-	m_prevAngles		= std::make_unique<float[]>(m_capacity);
-	m_cycleTimes		= std::make_unique<float[]>(m_capacity);
-	m_densityTimes		= std::make_unique<float[]>(m_capacity);
+							if (cellDistanceSqr >= rules.maxDistance) // cell is entirely out of reach
+								continue;
 
-	m_densities			= std::make_unique<std::uint32_t[]>(m_capacity);
-	m_cellIndices		= std::make_unique<std::uint16_t[]>(m_capacity);
+							const GridCell cell = grid.GetCell(grid.AtPos(gridCell.x + dx, gridCell.y + dy));
 
-	m_teleported		= std::make_unique<bool[]>(m_capacity);
-}
+							const bool testCohesion		= cellDistanceSqr < rules.cohDistance;
+							const bool testAlignment	= cellDistanceSqr < rules.aliDistance;
+							const bool testSeparation	= cellDistanceSqr < rules.sepDistance;
+							const bool testAvoidance	= cellDistanceSqr < rules.sepDistance;
 
-std::size_t BoidContainer::GetSize() const noexcept
-{
-	return m_size;
-}
+							const sf::Vector2f neighbourCell = cellDims * sf::Vector2f((float)dx, (float)dy);
+							const sf::Vector2f cellRel = neighbourCell - firstRelative;
 
-std::size_t BoidContainer::GetCapacity() const noexcept
-{
-	return m_capacity;
-}
+							for (int j = cell.start; j < cell.end; ++j) // do in one loop
+							{
+								const auto rhs = m_indices[j];
 
-void BoidContainer::Push(const sf::Vector2f& pos)
-{
-	Push(pos, sf::Vector2f(
-		util::Random(-1.0f, 1.0f),
-		util::Random(-1.0f, 1.0f)) * Config::Inst().Boids.SpeedMax);
+								if (lhs == rhs)
+									continue;
+
+								const sf::Vector2f dir	= cellRel + GetRelative(rhs);
+								const float distanceSqr = dir.lengthSquared();
+
+								if (m_species[rhs] == species) [[likely]]
+								{
+									AccumulatePair(forces, rules, dir, distanceSqr, m_prevVelocities[rhs], firstHeading, 
+										testCohesion, testAlignment, testSeparation);
+								}
+								else if (testAvoidance)
+									AccumulateAvoid(forces, rules, dir, distanceSqr);
+							}
+						}
+					}
+
+					ApplyForces(lhs, rules, forces);
+				});
+		}, policy);
 }
 
-void BoidContainer::Push(const sf::Vector2f& pos, const sf::Vector2f& velocity)
+template<class G>
+void BoidContainer::FlockTiled(const G& grid, Policy policy)
 {
-	if (m_size == m_capacity)
-		Reallocate((std::size_t)(1.5 * m_capacity + 1));
+	// boids sharing a cell also share their neighbours, the neighbours are therefore gathered once
+	// per cell into a small local tile that every boid in the cell is then tested against
 
-	m_indices[m_size] = (std::uint32_t)m_size;
+	m_cellRuns.clear();
 
-	m_prevVelocities[m_size] = m_velocities[m_size]	= velocity;
+	for (std::size_t i = 0; i < m_size; ++i)
+	{
+		if (i == 0 || m_cellIndices[m_indices[i]] != m_cellIndices[m_indices[i - 1]])
+			m_cellRuns.push_back((std::uint32_t)i);
+	}
 
-	m_prevPositions[m_size] = m_positions[m_size] = pos;
-	m_prevAngles[m_size] = m_angles[m_size] = ((velocity != sf::Vector2f()) ? velocity.angle().asRadians() : 0.0f);
+	if (m_cellRuns.empty())
+		return;
 
-	if (Config::Inst().Cycle.Random)
-		m_cycleTimes[m_size] = util::Random(0.0f, 1.0f);
+	m_cellRuns.push_back((std::uint32_t)m_size);
 
-	++m_size;
-}
+	const int rings = (grid.GetStencil() == GridStencil::Quadrant) ? 1 : GetRings(grid, m_maxRules); // gathered for every species in the cell
 
-void BoidContainer::Pop(std::size_t count)
-{
-	assert(count > 0); // pop nothing ???
+	PolicySelect([&](auto& pol)
+		{
+			std::for_each(pol, m_cellRuns.data(), m_cellRuns.data() + m_cellRuns.size() - 1,
+				[&](const std::uint32_t& runStart)
+				{
+					thread_local std::vector<TileEntry> tile; // grows, hence the sequenced policy
+					tile.clear();
 
-	std::size_t oldSize = m_size;
-	m_size = (count < m_size) ? (m_size - count) : 0;
+					const std::uint32_t runEnd = *(&runStart + 1);
 
-	(void)std::remove_if(m_indices.get(), m_indices.get() + oldSize,
-		[this](std::uint32_t i)
-		{
-			return i >= m_size; // push all older indices to the end
-		});
-}
+					const sf::Vector2f cellDims = grid.GetContDims();
+					const sf::Vector2i gridCell = sf::Vector2i(grid.RelativePos(m_prevPositions[m_indices[runStart]]));
 
-void BoidContainer::Reallocate(std::size_t capacity)
-{
-	m_capacity = capacity;
+					for (int dy = -rings; dy <= rings; ++dy)
+					{
+						for (int dx = -rings; dx <= rings; ++dx)
+						{
+							const GridCell cell = grid.GetCell(grid.AtPos(gridCell.x + dx, gridCell.y + dy));
+							const sf::Vector2f neighbourCell = cellDims * sf::Vector2f((float)dx, (float)dy);
 
-	const auto realloc = 
-		[this]<typename T>(std::unique_ptr<T[]>& ptr)
-		{
-			auto newPtr = std::make_unique<T[]>(m_capacity);
-			std::move(ptr.get(), ptr.get() + m_size, newPtr.get());
-			ptr = std::move(newPtr);
-		};
+							for (int j = cell.start; j < cell.end; ++j)
+							{
+								const auto rhs = m_indices[j];
+								tile.emplace_back(neighbourCell + GetRelative(rhs), m_prevVelocities[rhs], rhs, m_species[rhs]);
+							}
+						}
+					}
 
-	realloc(m_indices);
+					for (std::uint32_t i = runStart; i < runEnd; ++i)
+					{
+						const std::uint32_t lhs = m_indices[i];
 
-	realloc(m_positions);
-	realloc(m_prevPositions);
-	realloc(m_velocities);
-	realloc(m_prevVelocities);
-	realloc(m_relativePositions);
-	realloc(m_colors);
+						const std::uint8_t species			= m_species[lhs];
+						const FlockRules& rules				= m_speciesRules[species];
 
-	realloc(m_speeds);
-	realloc(m_angles);
-	realloc(m_prevAngles);
-	realloc(m_cycleTimes);
-	realloc(m_densityTimes);
+						const sf::Vector2f firstRelative	= GetRelative(lhs);
+						const sf::Vector2f firstHeading		= vu::Normalize(m_prevVelocities[lhs]);
 
-	realloc(m_densities);
-	realloc(m_cellIndices);
+						FlockForces forces;
 
-	realloc(m_teleported);
-}
+						for (const TileEntry& entry : tile)
+						{
+							if (entry.index == lhs)
+								continue;
 
-void BoidContainer::Reserve(std::size_t capacity)
-{
-	if (capacity > m_capacity) // Only reserve size if the given size is larger than current capacity
-		Reallocate(capacity);
+							const sf::Vector2f dir	= entry.position - firstRelative;
+							const float distanceSqr = dir.lengthSquared();
+
+							if (entry.species == species) [[likely]]
+								AccumulatePair(forces, rules, dir, distanceSqr, entry.velocity, firstHeading, true, true, true);
+							else
+								AccumulateAvoid(forces, rules, dir, distanceSqr);
+						}
+
+						ApplyForces(lhs, rules, forces);
+					}
+				});
+		}, Sequenced(policy));
 }
 
-void BoidContainer::PreUpdate(const Grid& grid)
+void BoidContainer::FlockSymmetric(const Grid& grid, Policy policy)
 {
-	for (std::size_t i = 0; i < m_size; ++i)
-	{
-		m_prevVelocities[i]	= m_velocities[i];
-	}
+	const int rings = GetRings(grid, m_maxRules);
 
-	for (std::size_t i = 0; i < m_size; ++i)
-	{
-		m_prevPositions[i] = m_positions[i];
-	}
+	std::fill(m_forces, m_forces + m_size, FlockForces{});
 
-	for (std::size_t i = 0; i < m_size; ++i)
+	// a cell writes to the boids of the cells [x - rings, x + rings] and [y, y + rings], cells of
+	// the same color are therefore at least that far apart, e.g., 6 colors for a single ring
+
+	const int periodX = 2 * rings + 1;
+	const int periodY = rings + 1;
+
+	const int coloredX = (grid.GetWidth() / periodX) * periodX;
+	const int coloredY = (grid.GetHeight() / periodY) * periodY;
+
+	for (int cy = 0; cy < periodY; ++cy)
 	{
-		m_prevAngles[i] = m_angles[i];
+		for (int cx = 0; cx < periodX; ++cx)
+		{
+			m_colorCells.clear();
+
+			for (int y = cy; y < coloredY; y += periodY)
+			{
+				for (int x = cx; x < coloredX; x += periodX)
+					m_colorCells.emplace_back(x, y);
+			}
+
+			PolicySelect([&](auto& pol)
+				{
+					std::for_each(pol, m_colorCells.begin(), m_colorCells.end(),
+						[&](const sf::Vector2i& cell)
+						{
+							FlockCell(grid, cell.x, cell.y, rings);
+						});
+				}, policy);
+		}
 	}
 
-	for (std::size_t i = 0; i < m_size; ++i)
-	{
-		const sf::Vector2f gridCellRaw		= grid.RelativePos(m_positions[i]);
-		const sf::Vector2i gridCell			= sf::Vector2i(gridCellRaw);
-		const sf::Vector2f gridCellOverflow = gridCellRaw - sf::Vector2f(gridCell);
+	// remaining cells along the edges do not fit a whole color period and could wrap around onto
+	// cells of the same color, they are few and done sequentially
 
-		m_relativePositions[i]	= gridCellOverflow * grid.GetContDims();
-		m_cellIndices[i]		= (std::uint16_t)grid.AtPos(gridCell);
+	for (int y = 0; y < grid.GetHeight(); ++y)
+	{
+		for (int x = (y < coloredY ? coloredX : 0); x < grid.GetWidth(); ++x)
+			FlockCell(grid, x, y, rings);
 	}
-}
 
-void BoidContainer::Sort()
-{
-	std::sort(m_indices.get(), m_indices.get() + m_size,
-		[this](std::uint32_t i0, std::uint32_t i1)
+	PolicySelect([&](auto& pol)
 		{
-			return m_cellIndices[i0] < m_cellIndices[i1];
-		});
+			std::for_each(pol, m_indices, m_indices + m_size,
+				[&](const std::uint32_t& lhs)
+				{
+					ApplyForces(lhs, m_speciesRules[m_species[lhs]], m_forces[lhs]);
+				});
+		}, policy);
 }
 
-void BoidContainer::UpdateCells(Grid& grid)
+void BoidContainer::FlockCell(const Grid& grid, int x, int y, int rings)
 {
-	if (m_size == 0)
-		return;
+	const GridCell cell = grid.GetCell(grid.AtPos(x, y));
 
-	grid.SetStartIndex(m_cellIndices[m_indices[0]], 0);
+	if (cell.start == cell.end)
+		return;
 
-	for (std::size_t i = 1; i < m_size; ++i)
-	{
-		const std::uint16_t cellIndex	= m_cellIndices[m_indices[i]];
-		const std::uint16_t otherIndex	= m_cellIndices[m_indices[i - 1]];
+	const sf::Vector2f cellDims = grid.GetContDims();
 
-		if (otherIndex != cellIndex)
+	const auto pair = [&](std::uint32_t lhs, std::uint32_t rhs, const sf::Vector2f& lhsHeading, const sf::Vector2f& dir)
 		{
-			grid.SetStartIndex(cellIndex, (int)i);
-			grid.SetEndIndex(otherIndex, (int)i - 1);
-		}
-	}
+			const float distanceSqr = dir.lengthSquared();
 
-	grid.SetEndIndex(m_cellIndices[m_indices[m_size - 1]], (int)m_size - 1);
-}
+			const std::uint8_t species = m_species[lhs];
 
-void BoidContainer::Interaction(const InputHandler& inputHandler, const sf::Vector2f& mousePos, float dt)
-{
-	const bool holdLeft		= inputHandler.GetButtonHeld(sf::Mouse::Button::Left);
-	const bool holdRight	= inputHandler.GetButtonHeld(sf::Mouse::Button::Right);
+			if (species != m_species[rhs]) // both keep their own distance
+			{
+				AccumulateAvoid(m_forces[lhs], m_speciesRules[species], dir, distanceSqr);
+				AccumulateAvoid(m_forces[rhs], m_speciesRules[m_species[rhs]], -dir, distanceSqr);
 
-	if (Config::Inst().Interaction.SteerEnabled && (holdLeft || holdRight))
-	{
-		for (std::size_t i = 0; i < m_size; ++i)
-		{
-			sf::Vector2f dir = vu::Direction(m_positions[i], mousePos);
+				return;
+			}
 
-			const float factor = holdLeft ? 1.0f :
-				(holdRight ? -1.0f : 0.0f);
+			const FlockRules& rules = m_speciesRules[species];
 
-			const float lengthOpt = vu::DistanceOpt(dir);
-			const float weight = 1.0f / (std::sqrtf(lengthOpt) + FLT_EPSILON);
+			if (distanceSqr >= rules.maxDistance)
+				return;
 
-			SteerTowards(m_velocities[i], m_prevVelocities[i], dir, lengthOpt, Config::Inst().Interaction.SteerTowardsFactor * weight * factor * dt);
-		}
-	}
-	else if (Config::Inst().Interaction.PredatorEnabled)
+			AccumulateSymmetric(m_forces[lhs], m_forces[rhs], rules, dir, distanceSqr, 
+				m_prevVelocities[lhs], m_prevVelocities[rhs], lhsHeading);
+		};
+
+	for (int i = cell.start; i < cell.end; ++i) // pairs within the cell
 	{
-		for (std::size_t i = 0; i < m_size; ++i)
-		{
-			sf::Vector2f dir = vu::Direction(m_positions[i], mousePos);
+		const std::uint32_t lhs = m_indices[i];
 
-			float lengthSqr = dir.lengthSquared();
-			if (lengthSqr <= Config::Inst().Interaction.PredatorDistance)
-			{
-				float weight = 1.0f / (std::sqrtf(lengthSqr / (Config::Inst().Interaction.PredatorDistance + FLT_EPSILON)) + FLT_EPSILON);
-				SteerTowards(m_velocities[i], m_prevVelocities[i], dir, -Config::Inst().Interaction.PredatorFactor * weight * dt);
-			}
+		const sf::Vector2f lhsRelative	= GetRelative(lhs);
+		const sf::Vector2f lhsHeading	= vu::Normalize(m_prevVelocities[lhs]);
+
+		for (int j = i + 1; j < cell.end; ++j)
+		{
+			const std::uint32_t rhs = m_indices[j];
+			pair(lhs, rhs, lhsHeading, GetRelative(rhs) - lhsRelative);
 		}
 	}
-}
 
-void BoidContainer::Flock(const Grid& grid, Policy policy)
-{
-	PolicySelect([&](auto& pol)
+	for (int dy = 0; dy <= rings; ++dy) // forward half of the stencil
+	{
+		for (int dx = (dy == 0 ? 1 : -rings); dx <= rings; ++dx)
 		{
-			std::for_each(pol, m_indices.get(), m_indices.get() + m_size,
-				[&](std::uint32_t lhs)
-				{
-					sf::Vector2f sep;
-					sf::Vector2f ali;
-					sf::Vector2f coh;
-
-					std::uint32_t sepCount = 0;
-					std::uint32_t aliCount = 0;
-					std::uint32_t cohCount = 0;
+			// closest distance between any two points of the cells
 
-					const sf::Vector2f firstPos			= m_positions[lhs];
-					const sf::Vector2f firstRelative	= m_relativePositions[lhs];
-					const float firstAngle				= m_angles[lhs];
+			const float gapX = (float)std::max(std::abs(dx) - 1, 0) * cellDims.x;
+			const float gapY = (float)std::max(dy - 1, 0) * cellDims.y;
 
-					static constexpr auto neighbourCount = 4; // max 4 neighbours at a time
+			if (gapX * gapX + gapY * gapY >= m_maxRules.maxDistance)
+				continue;
 
-					int neighIndices[neighbourCount]{};
-					sf::Vector2f neighbours[neighbourCount];
+			const GridCell other = grid.GetCell(grid.AtPos(x + dx, y + dy));
 
-					const sf::Vector2f gridCellRaw		= grid.RelativePos(firstPos);
-					const sf::Vector2i gridCell			= sf::Vector2i(gridCellRaw);
-					const sf::Vector2f gridCellOverflow = gridCellRaw - sf::Vector2f(gridCell);
+			if (other.start == other.end)
+				continue;
 
-					const int x = (gridCellOverflow.x > 0.5f ? 1 : -1);
-					const int y = (gridCellOverflow.y > 0.5f ? 1 : -1);
+			const sf::Vector2f neighbourCell = cellDims * sf::Vector2f((float)dx, (float)dy);
 
-					const int neighbour_x = gridCell.x + x;
-					const int neighbour_y = gridCell.y + y;
+			for (int i = cell.start; i < cell.end; ++i)
+			{
+				const std::uint32_t lhs = m_indices[i];
 
-					neighbours[0] = grid.GetContDims() * sf::Vector2f(0,		0);
-					neighbours[1] = grid.GetContDims() * sf::Vector2f((float)x,	0);
-					neighbours[2] = grid.GetContDims() * sf::Vector2f(0,		(float)y);
-					neighbours[3] = grid.GetContDims() * sf::Vector2f((float)x,	(float)y);
+				const sf::Vector2f cellRel		= neighbourCell - GetRelative(lhs);
+				const sf::Vector2f lhsHeading	= vu::Normalize(m_prevVelocities[lhs]);
 
-					neighIndices[0] = grid.AtPos(gridCell.x,	gridCell.y);	// current
-					neighIndices[1] = grid.AtPos(neighbour_x,	gridCell.y);	// left or right of current
-					neighIndices[2] = grid.AtPos(gridCell.x,	neighbour_y);	// top or bot of current
-					neighIndices[3] = grid.AtPos(neighbour_x,	neighbour_y);	// top left/right bot left/right of current
+				for (int j = other.start; j < other.end; ++j)
+				{
+					const std::uint32_t rhs = m_indices[j];
+					pair(lhs, rhs, lhsHeading, cellRel + GetRelative(rhs));
+				}
+			}
+		}
+	}
+}
 
-					Config& config = Config::Inst();
+template<class G>
+int BoidContainer::GetRings(const G& grid, const FlockRules& rules)
+{
+	const float cellMin = std::min(grid.GetContDims().x, grid.GetContDims().y);
+	return std::min((int)std::ceilf(std::sqrtf(rules.maxDistance) / cellMin), Grid::MAX_RINGS);
+}
 
-					const float cohDistance = config.Rules.CohDistance;
-					const float aliDistance = config.Rules.AliDistance;
-					const float sepDistance = config.Rules.SepDistance;
+template<class F>
+void BoidContainer::ForEachImpulseBoid(std::size_t impulse, F&& func) const
+{
+	if (m_impulsesGathered && impulse + 1 < m_impulseOffsets.size())
+	{
+		for (std::uint32_t j = m_impulseOffsets[impulse]; j < m_impulseOffsets[impulse + 1]; ++j)
+			func((std::size_t)m_impulseBoids[j]);
+	}
+	else
+	{
+		for (std::size_t i = 0; i < m_size; ++i)
+			func(i);
+	}
+}
 
-					const float negFOV = -config.Boids.ViewAngle;
-					const float posFOV =  config.Boids.ViewAngle;
+template<class F>
+void BoidContainer::ForEachStream(F&& func)
+{
+	func(m_indices);
+	func(m_rebinIndices);
 
-					for (int i = 0; i < neighbourCount; ++i)
-					{
-						const int gridCellIndex = neighIndices[i];
-						const int start = grid.GetStartIndices()[gridCellIndex];
+	ForEachBoidStream(func);
+}
+template<class F>
+void BoidContainer::ForEachBoidStream(F&& func)
+{
+	func(m_positions);
+	func(m_prevPositions);
+	func(m_velocities);
+	func(m_prevVelocities);
+	func(m_relativePositions);
+	func(m_colors);
 
-						if (start == -1)
-							continue;
+	func(m_cycleTimes);
+	func(m_densityTimes);
 
-						const int end = grid.GetEndIndices()[gridCellIndex];
+	func(m_forces);
 
-						const sf::Vector2f neighbourCell = neighbours[i];
-						const sf::Vector2f cellRel = neighbourCell - firstRelative;
+	func(m_densities);
+	func(m_cellIndices);
 
-						for (int j = start; j <= end; ++j) // do in one loop
-						{
-							const auto rhs = m_indices[j];
+	func(m_teleported);
+	func(m_cellMoved);
 
-							if (lhs == rhs)
-								continue;
+	func(m_ids);
+	func(m_ranks);
+	func(m_species);
+}
 
-							const sf::Vector2f dir	= cellRel + m_relativePositions[rhs];
-							const float distanceSqr = dir.lengthSquared();
+template<typename T>
+std::size_t BoidContainer::GetStreamSize(std::size_t capacity) noexcept
+{
+	return (capacity * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
 
-							const bool withinCohesion	= distanceSqr < cohDistance;
-							const bool withinAlignment	= distanceSqr < aliDistance;
+__forceinline sf::Vector2f BoidContainer::GetRelative(std::uint32_t index) const noexcept
+{
+	return sf::Vector2f(m_relativePositions[index]).componentWiseMul(m_relativeScale);
+}
 
-							const std::uint8_t flag = (static_cast<std::uint8_t>(withinCohesion) | static_cast<std::uint8_t>(withinAlignment) << 1);
+template<class G>
+void BoidContainer::PrefetchFlock(const G& grid, std::size_t position) const
+{
+	// boids are visited in cell order but their data is stored in insertion order, fetch the data
+	// of a boid further ahead and, when it is the first of its cell, the first members of the cells
+	// its stencil reaches that the stencil of the previous cell did not, which is only the leading
+	// column when the previous cell is the one to its left
 
-							switch (flag)
-							{
-								[[unlikely]] case 1U: // cohesion
-								{
-									const float angle		= vu::PI<> - std::abs(std::abs(vu::Angle(dir.y, dir.x) - firstAngle) - vu::PI<>);
-									const bool withinFOV	= angle > negFOV && angle < posFOV;
+	if (position >= m_size)
+		return;
 
-									coh += dir * (float)withinFOV; // Head towards center of boids
-									cohCount += withinFOV;
+	const std::uint32_t index = m_indices[position];
 
-									break; 
-								}
-								[[unlikely]] case 2U: // alignment
-								{
-									const float angle		= vu::PI<> - std::abs(std::abs(vu::Angle(dir.y, dir.x) - firstAngle) - vu::PI<>);
-									const bool withinFOV	= angle > negFOV && angle < posFOV;
+	util::Prefetch(&m_prevPositions[index]);
+	util::Prefetch(&m_relativePositions[index]);
+	util::Prefetch(&m_prevVelocities[index]);
 
-									ali += m_prevVelocities[rhs] * (float)withinFOV; // Align with every boids velocity
-									aliCount += withinFOV;
+	const std::uint64_t cellIndex = m_cellIndices[index];
+	const std::uint64_t prevIndex = (position > 0) ? m_cellIndices[m_indices[position - 1]] : cellIndex;
 
-									break;
-								}
-								[[likely]] case 3U: // both
-								{
-									const float angle		= vu::PI<> - std::abs(std::abs(vu::Angle(dir.y, dir.x) - firstAngle) - vu::PI<>);
-									const bool withinFOV	= angle > negFOV && angle < posFOV;
+	if (position > 0 && prevIndex == cellIndex)
+		return;
 
-									coh += dir * (float)withinFOV;
-									cohCount += withinFOV;
+	using CellKey = decltype(grid.AtPos(0, 0)); // int for the grid
 
-									ali += m_prevVelocities[rhs] * (float)withinFOV;
-									aliCount += withinFOV;
+	const sf::Vector2i cell = grid.CellPos(static_cast<CellKey>(cellIndex));
+	const sf::Vector2i prev = grid.CellPos(static_cast<CellKey>(prevIndex));
 
-									break;
-								}
-							}
+	const int rings = (grid.GetStencil() == GridStencil::Quadrant) ? 1 : GetRings(grid, m_maxRules);
+	const int firstX = (position > 0 && prev.y == cell.y && prev.x == cell.x - 1) ? rings : -rings;
 
-							if (distanceSqr < sepDistance)
-							{
-								sep += -dir / (distanceSqr ? distanceSqr : FLT_EPSILON);
-								++sepCount;
-							}
-						}
-					}
+	for (int dy = -rings; dy <= rings; ++dy)
+	{
+		for (int dx = firstX; dx <= rings; ++dx)
+		{
+			const GridCell other = grid.GetCell(grid.AtPos(cell.x + dx, cell.y + dy));
+			const int end = std::min(other.end, other.start + PREFETCH_MEMBERS);
 
-					if (cohCount) m_velocities[lhs] += SteerAt(m_prevVelocities[lhs], vu::Normalize(coh, config.Boids.SpeedMax)) * config.Rules.CohWeight;
-					if (aliCount) m_velocities[lhs] += SteerAt(m_prevVelocities[lhs], vu::Normalize(ali / (float)aliCount, config.Boids.SpeedMax)) * config.Rules.AliWeight;
-					if (sepCount) m_velocities[lhs] += SteerAt(m_prevVelocities[lhs], vu::Normalize(sep / (float)sepCount, config.Boids.SpeedMax)) * config.Rules.SepWeight;
+			for (int j = other.start; j < end; ++j)
+			{
+				const std::uint32_t rhs = m_indices[j];
 
-					m_densities[lhs] = std::max(std::max(cohCount, aliCount), sepCount);
-				});
-		}, policy);
+				util::Prefetch(&m_relativePositions[rhs]);
+				util::Prefetch(&m_prevVelocities[rhs]);
+			}
+		}
+	}
 }
 
+template void BoidContainer::PreUpdate<Grid>(const Grid&);
+template void BoidContainer::PreUpdate<SpatialHash>(const SpatialHash&);
+
+template void BoidContainer::Flock<Grid>(const Grid&, Policy);
+template void BoidContainer::Flock<SpatialHash>(const SpatialHash&, Policy);
+
+template std::size_t BoidContainer::Remove<Grid>(const Grid&, const sf::Vector2f&, float);
+template std::size_t BoidContainer::Remove<SpatialHash>(const SpatialHash&, const sf::Vector2f&, float);
+
+template void BoidContainer::GatherImpulses<Grid>(const Grid&, const std::vector<Impulse>&, float);
+template void BoidContainer::GatherImpulses<SpatialHash>(const SpatialHash&, const std::vector<Impulse>&, float);
+
 void BoidContainer::Update(const RectFloat& border, const std::vector<Impulse>& impulses, float dt)
 {
-	for (std::size_t i = 0; i < m_size; ++i)
+	m_maxStep = 0.0f;
+	m_teleportedIds.clear();
+
+	for (std::size_t s = 0; s < GetSpeciesCount(); ++s) // limits are constant over a segment
 	{
-		auto& velocity	= m_velocities[i];
-		auto& speed		= m_speeds[i];
+		const SpeciesSegment segment = GetSegment(s);
+		const FlockRules rules = GetFlockRules(s);
 
-		float lengthSquared = m_velocities[i].lengthSquared();
+		m_maxStep = std::max(m_maxStep, rules.speedMax * dt);
 
-		if (lengthSquared < Config::Inst().BoidSpeedMinSq)
-		{
-			velocity = vu::Normalize(velocity, std::sqrt(lengthSquared), Config::Inst().Boids.SpeedMin);
-			speed = Config::Inst().Boids.SpeedMin;
-		}
-		else if (lengthSquared > Config::Inst().BoidSpeedMaxSq)
-		{
-			velocity = vu::Normalize(velocity, std::sqrt(lengthSquared), Config::Inst().Boids.SpeedMax);
-			speed = Config::Inst().Boids.SpeedMax;
-		}
-		else
+		const float speedMinSq = rules.speedMin * rules.speedMin;
+		const float speedMaxSq = rules.speedMax * rules.speedMax;
+
+		for (std::size_t i = segment.start; i < segment.end; ++i)
 		{
-			speed = std::sqrt(lengthSquared);
+			auto& velocity = m_velocities[i];
+
+			float lengthSquared = m_velocities[i].lengthSquared();
+
+			if (lengthSquared < speedMinSq)
+			{
+				velocity = vu::Normalize(velocity, std::sqrt(lengthSquared), rules.speedMin);
+			}
+			else if (lengthSquared > speedMaxSq)
+			{
+				velocity = vu::Normalize(velocity, std::sqrt(lengthSquared), rules.speedMax);
+			}
 		}
 	}
 
 	for (std::size_t i = 0; i < m_size; ++i)
 	{
-		m_positions[i] += m_velocities[i] * dt;
+		m_positions[i] = m_prevPositions[i] + m_velocities[i] * dt;
 	}
 	
 	if (Config::Inst().Interaction.TurnAtBorder)
@@ -394,23 +1440,14 @@ void BoidContainer::Update(const RectFloat& border, const std::vector<Impulse>&
 		}
 	}
 
-	for (std::size_t i = 0; i < m_size; ++i)
-	{
-		auto& velocity = m_velocities[i];
-		auto& angle = m_angles[i];
-
-		angle = (velocity.x || velocity.y) ?
-			vu::Angle(velocity.y, velocity.x) : 0.0f;
-	}
-
 	if (!Config::Inst().Interaction.TurnAtBorder)
 	{
 		for (std::size_t i = 0; i < m_size; ++i)
 		{
 			if (m_teleported[i])
 			{
-				m_prevPositions[i]	= m_positions[i];
-				m_prevAngles[i]		= m_angles[i];
+				m_prevPositions[i] = m_positions[i];
+				m_teleportedIds.push_back(m_ids[i]);
 			}
 		}
 	}
@@ -429,25 +1466,27 @@ void BoidContainer::Update(const RectFloat& border, const std::vector<Impulse>&
 
 	if (Config::Inst().Impulse.Force != 0.0f)
 	{
-		for (const Impulse& impulse : impulses)
+		for (std::size_t j = 0; j < impulses.size(); ++j)
 		{
-			for (std::size_t i = 0; i < m_size; ++i)
-			{
-				const sf::Vector2f impulsePos = impulse.GetPosition();
-				const float impulseLength = impulse.GetLength();
+			const Impulse& impulse = impulses[j];
 
-				const float length = vu::Distance(m_positions[i], impulsePos);
-				const float diff = std::abs(length - impulseLength);
+			const sf::Vector2f impulsePos = impulse.GetPosition();
+			const float impulseLength = impulse.GetLength();
 
-				const float percentage = (impulseLength / Config::Inst().Impulse.FadeDistance);
-				const float size = impulse.GetSize() * (1.0f - percentage);
+			const float percentage = (impulseLength / Config::Inst().Impulse.FadeDistance);
+			const float size = impulse.GetSize() * (1.0f - percentage);
 
-				if (diff <= size)
+			ForEachImpulseBoid(j, [&](std::size_t i)
 				{
-					SteerTowards(m_velocities[i], m_prevVelocities[i],
-						vu::Direction(impulsePos, m_positions[i]), Config::Inst().Impulse.Force * (1.0f - percentage) * dt);
-				}
-			}
+					const float length = vu::Distance(m_positions[i], impulsePos);
+					const float diff = std::abs(length - impulseLength);
+
+					if (diff <= size)
+					{
+						SteerTowards(m_velocities[i], m_prevVelocities[i],
+							vu::Direction(impulsePos, m_positions[i]), Config::Inst().Impulse.Force * (1.0f - percentage) * dt, m_speciesRules[m_species[i]]);
+					}
+				});
 		}
 	}
 }
@@ -457,71 +1496,64 @@ void BoidContainer::UpdateColors(const RectFloat& border, const Fluid& fluid, co
 	const Config& config = Config::Inst();
 	std::uint32_t flag = config.Color.Flags;
 
-	std::fill_n(m_colors.get(), m_size, sf::Vector3f());
+	const bool positional	= (flag & CF_Positional) == CF_Positional;
+	const bool cycle		= (flag & CF_Cycle) == CF_Cycle && !config.Cycle.Colors.empty();
+	const bool density		= (flag & CF_Density) == CF_Density && !config.Density.Colors.empty() && config.Density.Density > 0;
+	const bool velocity		= (flag & CF_Velocity) == CF_Velocity && !config.Velocity.Colors.empty();
+	const bool rotation		= (flag & CF_Rotation) == CF_Rotation && !config.Rotation.Colors.empty();
+	const bool audio		= (flag & CF_Audio) == CF_Audio && !config.Audio.Colors.empty() && audioMeter != nullptr;
+	const bool fluidColor	= (flag & CF_Fluid) == CF_Fluid && !config.Fluid.Colors.empty();
+	const bool impulse		= !config.Impulse.Colors.empty() && !impulses.empty();
 
-	if (flag == CF_None) [[unlikely]]
-	{
-		for (std::size_t i = 0; i < m_size; ++i)
-			m_colors[i] = sf::Vector3f(1.0f, 1.0f, 1.0f);
-	}
-	else
-	{
-		if ((flag & CF_Positional) == CF_Positional)
-		{
-			for (std::size_t i = 0; i < m_size; ++i)
-				m_colors[i] += PositionColor(m_positions[i], border) * config.Color.PositionalWeight;
-		}
-		if ((flag & CF_Cycle) == CF_Cycle && !config.Cycle.Colors.empty())
-		{
-			for (std::size_t i = 0; i < m_size; ++i)
-				m_colors[i] += CycleColor(m_cycleTimes[i]) * config.Color.CycleWeight;
-		}
-		if ((flag & CF_Density) == CF_Density && !config.Density.Colors.empty() && config.Density.Density > 0)
-		{
-			for (std::size_t i = 0; i < m_size; ++i)
-				m_colors[i] += DensityColor(m_densities[i], m_densityTimes[i]) * config.Color.DensityWeight;
-		}
-		if ((flag & CF_Velocity) == CF_Velocity && !config.Velocity.Colors.empty())
-		{
-			for (std::size_t i = 0; i < m_size; ++i)
-				m_colors[i] += VelocityColor(m_speeds[i]) * config.Color.VelocityWeight;
-		}
-		if ((flag & CF_Rotation) == CF_Rotation && !config.Rotation.Colors.empty())
-		{
-			for (std::size_t i = 0; i < m_size; ++i)
-				m_colors[i] += RotationColor(m_angles[i]) * config.Color.RotationWeight;
-		}
-		if ((flag & CF_Audio) == CF_Audio && !config.Audio.Colors.empty() && audioMeter != nullptr)
-		{
-			float volume = std::fminf(audioMeter->GetVolume() * config.Audio.Strength, config.Audio.Limit);
+	const float volume = audio ? std::fminf(audioMeter->GetVolume() * config.Audio.Strength, config.Audio.Limit) : 0.0f;
 
-			for (std::size_t i = 0; i < m_size; ++i)
-				m_colors[i] += AudioColor(m_densities[i], volume) * config.Color.AudioWeight;
-		}
-		if ((flag & CF_Fluid) == CF_Fluid && !config.Fluid.Colors.empty())
+	const auto pack = [](const sf::Vector3f& color)
 		{
-			for (std::size_t i = 0; i < m_size; ++i)
-				m_colors[i] += fluid.GetColor(m_positions[i]);
-		}
-	}
+			return sf::Color(
+				(std::uint8_t)(std::clamp(color.x, 0.0f, 1.0f) * 255.9999f),
+				(std::uint8_t)(std::clamp(color.y, 0.0f, 1.0f) * 255.9999f),
+				(std::uint8_t)(std::clamp(color.z, 0.0f, 1.0f) * 255.9999f));
+		};
 
-	if (!config.Impulse.Colors.empty() && !impulses.empty())
+	// colors are accumulated per boid and only stored packed, as they are sent to the vertices
+
+	for (std::size_t s = 0; s < GetSpeciesCount(); ++s) // speed range is constant over a segment
 	{
-		for (std::size_t i = 0; i < m_size; ++i)
+		const SpeciesSegment segment = GetSegment(s);
+		const FlockRules rules = GetFlockRules(s);
+
+		for (std::size_t i = segment.start; i < segment.end; ++i)
 		{
-			for (const Impulse& impulse : impulses)
-				ImpulseColor(m_positions[i], m_colors[i], impulse);
+			sf::Vector3f color;
+
+			if (flag == CF_None) [[unlikely]]
+				color = sf::Vector3f(1.0f, 1.0f, 1.0f);
+
+			if (positional)	color += PositionColor(m_positions[i], border) * config.Color.PositionalWeight;
+			if (cycle)		color += CycleColor(m_cycleTimes[i]) * config.Color.CycleWeight;
+			if (density)	color += DensityColor(m_densities[i], m_densityTimes[i]) * config.Color.DensityWeight;
+			if (velocity)	color += VelocityColor(m_velocities[i].length(), rules) * config.Color.VelocityWeight;
+			if (rotation)	color += RotationColor(vu::Angle(m_velocities[i].y, m_velocities[i].x)) * config.Color.RotationWeight;
+			if (audio)		color += AudioColor(m_densities[i], volume) * config.Color.AudioWeight;
+			if (fluidColor)	color += fluid.GetColor(m_positions[i]);
+
+			m_colors[i] = pack(color);
 		}
 	}
 
-	for (std::size_t i = 0; i < m_size; ++i)
+	// impulses replace the color of the boids in their ring, later impulses over earlier ones
+
+	if (impulse)
 	{
-		m_colors[i] =
+		for (std::size_t j = 0; j < impulses.size(); ++j)
 		{
-			std::clamp(m_colors[i].x, 0.0f, 1.0f),
-			std::clamp(m_colors[i].y, 0.0f, 1.0f),
-			std::clamp(m_colors[i].z, 0.0f, 1.0f)
-		};
+			ForEachImpulseBoid(j, [&](std::size_t i)
+				{
+					sf::Vector3f color;
+					if (ImpulseColor(m_positions[i], color, impulses[j]))
+						m_colors[i] = pack(color);
+				});
+		}
 	}
 }
 
@@ -530,23 +1562,22 @@ void BoidContainer::UpdateVertices(sf::VertexArray& vertices, float interp, Poli
 	PolicySelect(
 		[this, &vertices, interp](auto& pol)
 		{
-			std::for_each(pol, m_indices.get(), m_indices.get() + m_size,
+			std::for_each(pol, m_indices, m_indices + m_size,
 				[this, &vertices, interp](std::uint32_t i)
 				{
 					const sf::Vector2f lerpPosition = vu::Lerp(m_prevPositions[i], m_positions[i], interp);
-					const float lerpAngle = -util::Lerp(sf::radians(m_prevAngles[i]), sf::radians(m_angles[i]), interp).asRadians();
+					const sf::Vector2f lerpVelocity = vu::Lerp(m_prevVelocities[i], m_velocities[i], interp);
+					const float lerpSpeed = lerpVelocity.length();
 
-					const sf::Vector3f& color = m_colors[i];
+					// the heading is the rotation, no need to go through the angle
+					const sf::Vector2f heading = (lerpSpeed > FLT_EPSILON) ? lerpVelocity / lerpSpeed : sf::Vector2f(1.0f, 0.0f);
 
-					const sf::Color c = sf::Color(
-						(std::uint8_t)(color.x * 255.9999f),
-						(std::uint8_t)(color.y * 255.9999f),
-						(std::uint8_t)(color.z * 255.9999f));
+					const sf::Color c = m_colors[i];
 
 					const sf::Vector2f hSize = Config::Inst().BoidHalfSize;
 
-					const float cos	= std::cos(lerpAngle); // build a transform
-					const float sin	= std::sin(lerpAngle);
+					const float cos	=  heading.x; // build a transform
+					const float sin	= -heading.y;
 					const float sxc = hSize.x * cos;
 					const float syc = hSize.y * cos;
 					const float sxs = hSize.x * sin;
@@ -638,24 +1669,24 @@ bool BoidContainer::TeleportAtBorder(sf::Vector2f& pos, const RectFloat& border)
 	return (previous != pos);
 }
 
-sf::Vector2f BoidContainer::SteerAt(const sf::Vector2f& prevVel, const sf::Vector2f& steerDir)
+sf::Vector2f BoidContainer::SteerAt(const sf::Vector2f& prevVel, const sf::Vector2f& steerDir, float steerMax)
 {
-	return vu::Limit(vu::Direction(prevVel, steerDir), Config::Inst().Boids.SteerMax);
+	return vu::Limit(vu::Direction(prevVel, steerDir), steerMax);
 }
 
-void BoidContainer::SteerTowards(sf::Vector2f& vel, const sf::Vector2f& prevVel, const sf::Vector2f& direction, float length, float weight)
+void BoidContainer::SteerTowards(sf::Vector2f& vel, const sf::Vector2f& prevVel, const sf::Vector2f& direction, float length, float weight, const FlockRules& rules)
 {
 	if (std::abs(weight) < FLT_EPSILON)
 		return;
 
-	const sf::Vector2f steer = vu::Normalize(direction, length, Config::Inst().Boids.SpeedMax);
+	const sf::Vector2f steer = vu::Normalize(direction, length, rules.speedMax);
 
-	vel += SteerAt(prevVel, steer) * weight;
+	vel += SteerAt(prevVel, steer, rules.steerMax) * weight;
 }
 
-void BoidContainer::SteerTowards(sf::Vector2f& vel, const sf::Vector2f& prevVel, const sf::Vector2f& point, float weight)
+void BoidContainer::SteerTowards(sf::Vector2f& vel, const sf::Vector2f& prevVel, const sf::Vector2f& point, float weight, const FlockRules& rules)
 {
-	SteerTowards(vel, prevVel, point, point.length(), weight);
+	SteerTowards(vel, prevVel, point, point.length(), weight, rules);
 }
 
 void BoidContainer::ResetCycleTimes()
@@ -710,9 +1741,9 @@ sf::Vector3f BoidContainer::DensityColor(std::uint32_t density, float densityTim
 	return vu::Lerp(color1, color2, newT);
 }
 
-sf::Vector3f BoidContainer::VelocityColor(float speed)
+sf::Vector3f BoidContainer::VelocityColor(float speed, const FlockRules& rules)
 {
-	const float velocity_percentage = std::clamp((speed - Config::Inst().Boids.SpeedMin) * Config::Inst().BoidSpeedInv, 0.0f, 1.0f);
+	const float velocity_percentage = std::clamp((speed - rules.speedMin) * rules.speedInv, 0.0f, 1.0f);
 
 	const float scaledVlocity = velocity_percentage * (float)(Config::Inst().Velocity.Colors.size() - 1);
 
@@ -761,7 +1792,7 @@ sf::Vector3f BoidContainer::AudioColor(std::uint32_t density, float volume)
 	return vu::Lerp(color1, color2, newT);
 }
 
-void BoidContainer::ImpulseColor(const sf::Vector2f& pos, sf::Vector3f& color, const Impulse& impulse)
+bool BoidContainer::ImpulseColor(const sf::Vector2f& pos, sf::Vector3f& color, const Impulse& impulse)
 {
 	const sf::Vector2f impulsePos = impulse.GetPosition();
 	const float impulseLength = impulse.GetLength();
@@ -785,5 +1816,9 @@ void BoidContainer::ImpulseColor(const sf::Vector2f& pos, sf::Vector3f& color, c
 		const float newT = scaled_length - std::floorf(scaled_length);
 
 		color = vu::Lerp(color1, color2, newT);
+
+		return true;
 	}
+
+	return false;
 }
@@ -2,20 +2,96 @@
 
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/Color.hpp>
 
 #include <memory>
+#include <new>
+#include <cstddef>
+#include <vector>
 
 #include "Grid.h"
+#include "SpatialHash.h"
 #include "AudioMeter.h"
 #include "Impulse.h"
 #include "Fluid.h"
+#include "PredatorContainer.h"
+#include "ObstacleField.h"
 
 #include "PolicySelect.h"
 #include "Rectangle.hpp"
 #include "InputHandler.h"
 
+struct SpeciesSegment
+{
+	std::size_t start	{0};
+	std::size_t end		{0}; // one past the last
+};
+
+// boids are stored sorted by species, every species is a contiguous segment so that rules, limits
+// and textures can be applied per segment, the neighbour search still runs over all species at once
+//
 class BoidContainer
 {
+private:
+	static constexpr std::size_t ALIGNMENT = 64; // cache line and widest vector register
+
+	static constexpr std::size_t MIN_CAPACITY	= 64;
+	static constexpr std::size_t GROWTH			= 2; // capacity is multiplied by this when full
+	static constexpr std::size_t SHRINK			= 4; // and shrunk to GROWTH times the size once it falls below capacity / SHRINK
+
+	struct ArenaDeleter
+	{
+		void operator()(std::byte* ptr) const
+		{
+			::operator delete[](ptr, std::align_val_t(ALIGNMENT));
+		}
+	};
+
+	static constexpr float RELATIVE_MAX = 65535.0f; // relative positions are stored as 16-bit fractions of the cell
+
+	static constexpr std::size_t PREFETCH_DISTANCE	= 8; // boids ahead in the sorted order
+	static constexpr int PREFETCH_MEMBERS			= 8; // first members of a cell to fetch
+
+	struct FlockRules
+	{
+		float cohDistance	{0.0f};
+		float aliDistance	{0.0f};
+		float sepDistance	{0.0f};
+		float maxDistance	{0.0f};
+		float cosFOV		{-1.0f};	// neighbours are seen when the cosine of their angle to the heading is above
+		bool fullFOV		{true};		// sees all around, skip the test
+
+		float sepWeight		{0.0f};
+		float aliWeight		{0.0f};
+		float cohWeight		{0.0f};
+		float avoidWeight	{0.0f};
+		float speedMin		{0.0f};
+		float speedMax		{0.0f};
+		float speedInv		{1.0f};		// inverse of the speed range, for the velocity color
+		float steerMax		{0.0f};
+	};
+
+	struct FlockForces
+	{
+		sf::Vector2f	sep;
+		sf::Vector2f	ali;
+		sf::Vector2f	coh;
+		sf::Vector2f	avoid; // separation from other species
+
+		std::uint32_t	sepCount	{0};
+		std::uint32_t	aliCount	{0};
+		std::uint32_t	cohCount	{0};
+		std::uint32_t	avoidCount	{0};
+	};
+
+	struct TileEntry
+	{
+		sf::Vector2f	position;	// relative to the cell of the tile
+		sf::Vector2f	velocity;
+		std::uint32_t	index		{0};
+		std::uint8_t	species		{0};
+	};
+
 public:
 	BoidContainer(std::size_t capacity);
 
@@ -23,26 +99,87 @@ public:
 	std::size_t GetSize() const noexcept;
 	std::size_t GetCapacity() const noexcept;
 
+	const sf::Vector2f* GetPositions() const noexcept;
+	const sf::Vector2f* GetVelocities() const noexcept;
+	const std::uint16_t* GetDensities() const noexcept;
+	const std::uint32_t* GetIds() const noexcept;
+	const std::uint8_t* GetSpecies() const noexcept;
+	std::uint32_t GetIndex(std::uint32_t id) const noexcept; // UINT32_MAX once removed
+
+	std::size_t GetSpeciesCount() const noexcept;
+	SpeciesSegment GetSegment(std::size_t species) const noexcept;
+
 public:
 	void Push(const sf::Vector2f& pos);
 	void Push(const sf::Vector2f& pos, const sf::Vector2f& velocity);
 
+	// boids are placed at the end of the segment of their species, the first boid of every following
+	// segment is moved to its end to make room, species not given are picked at random by share
+	//
+	void Push(const sf::Vector2f& pos, const sf::Vector2f& velocity, std::uint8_t species);
+
+	// pushes boids at the same position with directions spread randomly around the given direction,
+	// capacity is grown at most once for the whole batch
+	//
+	void PushMany(std::size_t count, const sf::Vector2f& pos, const sf::Vector2f& direction, float spread);
+
 	void Pop(std::size_t count = 1);
+	void Clear();
+
+	// boids are removed by moving the last boid of their species into their place, which changes the
+	// index of that boid, ids are stable for as long as the boid lives and are reused after it has been removed
+	//
+	bool Remove(std::uint32_t id);
+
+	// removes the boids within the radius by searching the cells around it padded by how far boids
+	// have moved since they were binned, and the boids that wrapped around the border, falls back to
+	// testing every boid when boids have been removed since the cells were last built
+	//
+	template<class G>
+	std::size_t Remove(const G& grid, const sf::Vector2f& center, float radius);
+
+	template<class P>
+	std::size_t RemoveIf(P&& predicate);
 
 public:
 	void Reallocate(std::size_t capacity);
 	void Reserve(std::size_t capacity);
 
 public:
-	void PreUpdate(const Grid& grid);
-
-	void Sort();
+	// the neighbour search works on any cell structure that maps positions to cell keys and keys to
+	// ranges of sorted boids, instantiated for Grid and SpatialHash
+	//
+	template<class G>
+	void PreUpdate(const G& grid);
 
+	// sorts the boids by cell and builds the cell ranges
+	//
 	void UpdateCells(Grid& grid);
+	void UpdateCells(SpatialHash& grid);
+
+	template<class G>
+	void Flock(const G& grid, Policy policy);
 
+	// adds to the velocities written by Flock, must therefore be called after it
+	//
 	void Interaction(const InputHandler& inputHandler, const sf::Vector2f& mousePos, float dt);
 
-	void Flock(const Grid& grid, Policy policy);
+	// steers away from the predators in the cells around every boid, same as from the mouse, must
+	// also be called after Flock
+	//
+	void AvoidPredators(const PredatorContainer& predators, float dt, Policy policy);
+
+	// steers down the gradient of the distance field, harder the closer to the obstacles, must also
+	// be called after Flock
+	//
+	void AvoidObstacles(const ObstacleField& obstacles, float dt, Policy policy);
+
+	// collects the boids in the cells that the ring of every impulse passes through, padded by how
+	// far boids move in a tick, Update and UpdateColors then only test those rather than every boid,
+	// must be called after UpdateCells and is undone by pushing or removing boids
+	//
+	template<class G>
+	void GatherImpulses(const G& grid, const std::vector<Impulse>& impulses, float dt);
 
 	void Update(const RectFloat& border, const std::vector<Impulse>& impulses, float dt);
 
@@ -61,43 +198,160 @@ public:
 	static bool TeleportAtBorder(sf::Vector2f& pos, const RectFloat& border);
 
 public:
-	static sf::Vector2f SteerAt(const sf::Vector2f& prevVel, const sf::Vector2f& steerDir);
+	static sf::Vector2f SteerAt(const sf::Vector2f& prevVel, const sf::Vector2f& steerDir, float steerMax);
 
-	static void SteerTowards(sf::Vector2f& vel, const sf::Vector2f& prevVel, const sf::Vector2f& direction, float length, float weight);
-	static void SteerTowards(sf::Vector2f& vel, const sf::Vector2f& prevVel, const sf::Vector2f& point, float weight);
+	static void SteerTowards(sf::Vector2f& vel, const sf::Vector2f& prevVel, const sf::Vector2f& direction, float length, float weight, const FlockRules& rules);
+	static void SteerTowards(sf::Vector2f& vel, const sf::Vector2f& prevVel, const sf::Vector2f& point, float weight, const FlockRules& rules);
 
 	void ResetCycleTimes();
 
 private:
+	[[nodiscard]] std::size_t GetGrowth(std::size_t required) const noexcept;
+
+	void RemoveAt(std::uint32_t index);
+
+	[[nodiscard]] std::uint32_t OpenSlot(std::uint8_t species);
+	void MoveSlot(std::uint32_t from, std::uint32_t to);
+
+	[[nodiscard]] static std::uint8_t RandomSpecies();
+
+	void Sort();
+
+	// only relocates the boids that changed cell, relies on the order being sorted by the cells
+	// from the previous tick
+	//
+	[[nodiscard]] bool CanRebin() const;
+	void Rebin();
+
+	// the gathered boids of the impulse or every boid when they have not been gathered
+	//
+	template<class F>
+	void ForEachImpulseBoid(std::size_t impulse, F&& func) const;
+
+	template<class F>
+	void ForEachStream(F&& func);
+	template<class F>
+	void ForEachBoidStream(F&& func); // streams indexed by boid rather than by order
+
+	template<typename T>
+	[[nodiscard]] static std::size_t GetStreamSize(std::size_t capacity) noexcept;
+
+	[[nodiscard]] sf::Vector2f GetRelative(std::uint32_t index) const noexcept;
+
+	template<class G>
+	void PrefetchFlock(const G& grid, std::size_t position) const;
+
+	template<class G>
+	void FlockTiled(const G& grid, Policy policy);
+
+	template<class G>
+	static int GetRings(const G& grid, const FlockRules& rules);
+
+	static FlockRules GetFlockRules(std::size_t species);
+	void UpdateRules();
+
+	static void AccumulatePair(
+		FlockForces& forces, const FlockRules& rules, 
+		const sf::Vector2f& dir, float distanceSqr, 
+		const sf::Vector2f& otherVelocity, const sf::Vector2f& firstHeading, 
+		bool testCohesion, bool testAlignment, bool testSeparation);
+
+	// other species are only kept at a distance
+	//
+	static void AccumulateAvoid(FlockForces& forces, const FlockRules& rules, const sf::Vector2f& dir, float distanceSqr);
+
+	void ApplyForces(std::uint32_t lhs, const FlockRules& rules, const FlockForces& forces);
+
+	// same as accumulate pair but for both boids of the pair at once, only the field of view differs
+	// between them, dir points from lhs to rhs
+	//
+	static void AccumulateSymmetric(
+		FlockForces& lhsForces, FlockForces& rhsForces, const FlockRules& rules, 
+		const sf::Vector2f& dir, float distanceSqr, 
+		const sf::Vector2f& lhsVelocity, const sf::Vector2f& rhsVelocity, const sf::Vector2f& lhsHeading);
+
+	// evaluates every rule once per pair over half the stencil and adds it to both boids, cells are
+	// colored so that cells of the same color never write to the same boids and can run in parallel
+	//
+	void FlockSymmetric(const Grid& grid, Policy policy);
+	void FlockCell(const Grid& grid, int x, int y, int rings);
+
 	static sf::Vector3f PositionColor(const sf::Vector2f& pos, const RectFloat& border);
 	static sf::Vector3f CycleColor(float cycleTime);
 	static sf::Vector3f DensityColor(std::uint32_t density, float densityTime);
-	static sf::Vector3f VelocityColor(float speed);
+	static sf::Vector3f VelocityColor(float speed, const FlockRules& rules);
 	static sf::Vector3f RotationColor(float angle);
 	static sf::Vector3f AudioColor(std::uint32_t density, float volume);
-	static void ImpulseColor(const sf::Vector2f& pos, sf::Vector3f& color, const Impulse& impulse);
+	static bool ImpulseColor(const sf::Vector2f& pos, sf::Vector3f& color, const Impulse& impulse);
 
 private:
-	std::unique_ptr<std::uint32_t[]>	m_indices;
+	std::unique_ptr<std::byte[], ArenaDeleter> m_arena; // every stream below is carved out of it
+
+	std::uint32_t*		m_indices				{nullptr};
+
+	sf::Vector2f*		m_positions				{nullptr};
+	sf::Vector2f*		m_prevPositions			{nullptr};
+	sf::Vector2f*		m_velocities			{nullptr};
+	sf::Vector2f*		m_prevVelocities		{nullptr};
+	sf::Vector2<std::uint16_t>*	m_relativePositions	{nullptr}; // within the cell, decoded with m_relativeScale
+	sf::Color*			m_colors				{nullptr};
+
+	float*				m_cycleTimes			{nullptr};
+	float*				m_densityTimes			{nullptr};
+
+	FlockForces*		m_forces				{nullptr}; // accumulated by the symmetric pass
+
+	std::uint16_t*		m_densities				{nullptr};
+	std::uint64_t*		m_cellIndices			{nullptr}; // wide enough for the keys of the spatial hash
+	std::uint32_t*		m_rebinIndices			{nullptr};
 
-	std::unique_ptr<sf::Vector2f[]>		m_positions;
-	std::unique_ptr<sf::Vector2f[]>		m_prevPositions;
-	std::unique_ptr<sf::Vector2f[]>		m_velocities;
-	std::unique_ptr<sf::Vector2f[]>		m_prevVelocities;
-	std::unique_ptr<sf::Vector2f[]>		m_relativePositions;
-	std::unique_ptr<sf::Vector3f[]>		m_colors;
+	bool*				m_teleported			{nullptr};
+	bool*				m_cellMoved				{nullptr};
 
-	std::unique_ptr<float[]>			m_speeds;
-	std::unique_ptr<float[]>			m_angles;
-	std::unique_ptr<float[]>			m_prevAngles;
-	std::unique_ptr<float[]>			m_cycleTimes;
-	std::unique_ptr<float[]>			m_densityTimes;
+	std::uint32_t*		m_ids					{nullptr};
+	std::uint32_t*		m_ranks					{nullptr}; // position of every boid in the order
+	std::uint8_t*		m_species				{nullptr};
 
-	std::unique_ptr<std::uint32_t[]>	m_densities;
-	std::unique_ptr<std::uint16_t[]>	m_cellIndices;
+	std::vector<std::uint32_t>			m_cellRuns; // start of every occupied cell in the sorted order
+	std::vector<sf::Vector2i>			m_colorCells;
 
-	std::unique_ptr<bool[]>				m_teleported;
+	std::vector<std::uint32_t>			m_impulseOffsets;	// start of the boids of every impulse followed by the total
+	std::vector<std::uint32_t>			m_impulseBoids;
+	bool								m_impulsesGathered	{false};
 
-	std::size_t	m_size		{0};
-	std::size_t	m_capacity	{0};
+	std::vector<std::uint32_t>			m_slots; // index of every id, UINT32_MAX when removed
+	std::vector<std::uint32_t>			m_freeIds;
+	std::vector<std::uint32_t>			m_removeIds;
+	std::vector<std::uint32_t>			m_teleportedIds; // wrapped around the border in the last update, far from their cell
+
+	std::vector<std::uint32_t>			m_segments; // start of every species
+	std::vector<FlockRules>				m_speciesRules;
+	FlockRules							m_maxRules; // largest distances of all species
+
+	sf::Vector2f m_relativeScale;
+
+	std::size_t	m_size			{0};
+	std::size_t	m_capacity		{0};
+	std::size_t	m_cellChanges	{0};
+	std::size_t	m_firstMoved	{0};		// lowest rank of the boids that changed cell
+	std::size_t	m_binnedSize	{0};		// boids placed in the cells when they were last built
+	bool		m_orderChanged	{false};	// boids removed since, cell ranges are out of date
+	float		m_maxStep		{0.0f};		// farthest any boid has moved since the cells were built, besides teleports
 };
+
+template<class P>
+std::size_t BoidContainer::RemoveIf(P&& predicate)
+{
+	std::size_t removed = 0;
+
+	for (std::size_t i = m_size; i-- > 0;) // boid moved into the hole has already been tested
+	{
+		if (predicate(m_ids[i], m_positions[i]))
+		{
+			RemoveAt((std::uint32_t)i);
+			++removed;
+		}
+	}
+
+	return removed;
+}
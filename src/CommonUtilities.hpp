@@ -9,6 +9,10 @@
 
 #include <SFML/System/Angle.hpp>
 
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
 namespace util
 {
 	template<typename T>
@@ -117,7 +121,23 @@ namespace util
 		return result;
 	}
 
-	static thread_local std::mt19937_64 dre(std::random_device{}());
+	// hints that the cache line at the address will soon be read
+	//
+	inline void Prefetch(const void* ptr) noexcept
+	{
+#if defined(_MSC_VER)
+		_mm_prefetch(static_cast<const char*>(ptr), _MM_HINT_T0);
+#else
+		__builtin_prefetch(ptr);
+#endif
+	}
+
+	inline thread_local std::mt19937_64 dre(std::random_device{}());
+
+	inline void Seed(std::uint64_t seed)
+	{
+		dre.seed(seed);
+	}
 
 	template<std::floating_point T>
 	inline T Random(T min, T max)
@@ -35,6 +35,7 @@ void ReadJSON(Config& oc, nlohmann::json& json)
 	auto& boids			= ic[BOIDS];
 	auto& rules			= ic[RULES];
 	auto& interaction	= ic[INTERACTION];
+	auto& obstacles		= ic[OBSTACLES];
 	auto& color			= ic[COLOR];
 	auto& misc			= ic[MISC];
 
@@ -63,10 +64,36 @@ void ReadJSON(Config& oc, nlohmann::json& json)
 	oc.Rules.SepWeight				= rules["SepWeight"];
 	oc.Rules.AliWeight				= rules["AliWeight"];
 	oc.Rules.CohWeight				= rules["CohWeight"];
+	oc.Rules.AvoidWeight			= rules["AvoidWeight"];
+
+	oc.Species.clear();
+	for (const auto& species : ic[SPECIES])
+	{
+		SpeciesConfig sc;
+
+		sc.Texture			= species["Texture"];
+		sc.Share			= species["Share"];
+		sc.SpeedMax			= species["SpeedMax"];
+		sc.SpeedMin			= species["SpeedMin"];
+		sc.SteerMax			= species["SteerMax"];
+		sc.SepDistance		= species["SepDistance"];
+		sc.AliDistance		= species["AliDistance"];
+		sc.CohDistance		= species["CohDistance"];
+		sc.SepWeight		= species["SepWeight"];
+		sc.AliWeight		= species["AliWeight"];
+		sc.CohWeight		= species["CohWeight"];
+		sc.AvoidWeight		= species["AvoidWeight"];
+
+		oc.Species.push_back(sc);
+	}
+
+	if (oc.Species.size() >= UINT8_MAX) // stored per boid in a byte
+		oc.Species.resize(UINT8_MAX - 1);
 
 	oc.Interaction.BoidAddAmount		= interaction["BoidAddAmount"];
 	oc.Interaction.BoidAddMouseDiff		= interaction["BoidAddMouseDiff"];
 	oc.Interaction.BoidRemoveAmount		= interaction["BoidRemoveAmount"];
+	oc.Interaction.BoidRemoveRadius		= interaction["BoidRemoveRadius"];
 
 	oc.Interaction.SteerEnabled			= interaction["SteerEnabled"];
 	oc.Interaction.SteerTowardsFactor	= interaction["SteerTowardsFactor"];
@@ -75,11 +102,37 @@ void ReadJSON(Config& oc, nlohmann::json& json)
 	oc.Interaction.PredatorEnabled		= interaction["PredatorEnabled"];
 	oc.Interaction.PredatorDistance		= interaction["PredatorDistance"];
 	oc.Interaction.PredatorFactor		= interaction["PredatorFactor"];
+	oc.Interaction.PredatorCount		= interaction["PredatorCount"];
+	oc.Interaction.PredatorSpeed		= interaction["PredatorSpeed"];
+	oc.Interaction.PredatorColor		= ConvertToColor(interaction["PredatorColor"]);
 
 	oc.Interaction.TurnAtBorder			= interaction["TurnAtBorder"];
 	oc.Interaction.TurnMarginFactor		= interaction["TurnMarginFactor"];
 	oc.Interaction.TurnFactor			= interaction["TurnFactor"];
 
+	oc.Obstacles.Enabled				= obstacles["Enabled"];
+	oc.Obstacles.Mask					= obstacles["Mask"];
+	oc.Obstacles.Color					= ConvertToColor(obstacles["Color"]);
+	oc.Obstacles.CellSize				= obstacles["CellSize"];
+	oc.Obstacles.Distance				= obstacles["Distance"];
+	oc.Obstacles.Factor					= obstacles["Factor"];
+
+	oc.Obstacles.Circles.clear();
+	for (const auto& circle : obstacles["Circles"])
+		oc.Obstacles.Circles.push_back(ObstacleCircle{ sf::Vector2f(circle["x"], circle["y"]), circle["r"] });
+
+	oc.Obstacles.Polygons.clear();
+	for (const auto& polygon : obstacles["Polygons"])
+	{
+		std::vector<sf::Vector2f>& points = oc.Obstacles.Polygons.emplace_back();
+
+		for (const auto& point : polygon)
+			points.emplace_back(point["x"], point["y"]);
+
+		if (points.size() < 3) // encloses nothing
+			oc.Obstacles.Polygons.pop_back();
+	}
+
 	std::vector<int> temp_color_options = color["ColorOptions"];
 	oc.Color.Flags = CF_None;
 	for (std::size_t i = 0; i < temp_color_options.size(); ++i)
@@ -161,16 +214,39 @@ void ReadJSON(Config& oc, nlohmann::json& json)
 	oc.Impulse.Colors = ConvertToColorList(color["ImpulseColors"]);
 
 	oc.Misc.GridExtraCells			= misc["GridExtraCells"];
+	oc.Misc.GridStencil				= misc["GridStencil"];
+	oc.Misc.GridHashed				= misc["GridHashed"];
+	oc.Misc.GridIncremental			= misc["GridIncremental"];
+	oc.Misc.GridMorton				= misc["GridMorton"];
+	oc.Misc.FlockTiled				= misc["FlockTiled"];
+	oc.Misc.FlockSymmetric			= misc["FlockSymmetric"];
 	oc.Misc.CameraEnabled			= misc["CameraEnabled"];
 	oc.Misc.CameraZoom				= misc["CameraZoom"];
 	oc.Misc.VerticalSync			= misc["VerticalSync"];
 	oc.Misc.MaxFramerate			= misc["MaxFramerate"];
 	oc.Misc.PhysicsUpdateFreq		= misc["PhysicsUpdateFreq"];
 	oc.Misc.PolicyThreshold			= misc["PolicyThreshold"];
+	oc.Misc.PolicyAutoTune			= misc["PolicyAutoTune"];
+	oc.Misc.PolicyTuneInterval		= misc["PolicyTuneInterval"];
 
 	oc.Misc.DebugEnabled			= misc["DebugEnabled"];
 	oc.Misc.DebugUpdateFreq			= misc["DebugUpdateFreq"];
 	oc.Misc.DebugToggleKey			= misc["DebugToggleKey"];
+
+	oc.Misc.RecordPath				= misc["RecordPath"];
+	oc.Misc.ReplayPath				= misc["ReplayPath"];
+
+	oc.Misc.TrajectoryPath			= misc["TrajectoryPath"];
+	oc.Misc.TrajectoryBufferSize	= misc["TrajectoryBufferSize"];
+	oc.Misc.TrajectoryCompress		= misc["TrajectoryCompress"];
+
+	oc.Misc.CapturePath				= misc["CapturePath"];
+	oc.Misc.CaptureFormat			= misc["CaptureFormat"];
+	oc.Misc.CaptureFramerate		= misc["CaptureFramerate"];
+	oc.Misc.CaptureBufferSize		= misc["CaptureBufferSize"];
+	oc.Misc.CaptureWidth			= misc["CaptureWidth"];
+	oc.Misc.CaptureHeight			= misc["CaptureHeight"];
+	oc.Misc.CaptureFrames			= misc["CaptureFrames"];
 }
 
 Config::Config()
@@ -184,46 +260,96 @@ void Config::Load()
 	std::ifstream projectFile(FILE_NAME);
 	if (projectFile.good())
 	{
-		try
-		{
-			LoadStatus = false;
-			Config temp = *this;
+		Load(projectFile);
+	}
+}
 
-			nlohmann::json json = nlohmann::json::parse(projectFile, nullptr, true, true);
-			ReadJSON(temp, json);
+void Config::Load(std::istream& stream)
+{
+	try
+	{
+		LoadStatus = false;
+		Config temp = *this;
 
-			*this = temp;
-			LoadStatus = true;
+		nlohmann::json json = nlohmann::json::parse(stream, nullptr, true, true);
+		ReadJSON(temp, json);
 
-			UpdateMisc();
-		}
-		catch (nlohmann::json::parse_error) { }
-		catch (nlohmann::detail::type_error e) { }
+		*this = temp;
+		LoadStatus = true;
+
+		UpdateMisc();
 	}
+	catch (nlohmann::json::parse_error) { }
+	catch (nlohmann::detail::type_error e) { }
 }
 
 std::vector<Rebuild> Config::Refresh(Config& prev)
+{
+	Load();
+	return GetRebuilds(prev);
+}
+
+std::vector<Rebuild> Config::Refresh(Config& prev, std::istream& stream)
+{
+	Load(stream);
+	return GetRebuilds(prev);
+}
+
+std::vector<Rebuild> Config::GetRebuilds(const Config& prev) const
 {
 	std::vector<Rebuild> result;
 	result.reserve((int)Rebuild::Count);
 
-	Load();
+	const bool speciesDistances = std::ranges::equal(prev.Species, Species, [](const SpeciesConfig& lhs, const SpeciesConfig& rhs)
+		{
+			return lhs.SepDistance == rhs.SepDistance && lhs.AliDistance == rhs.AliDistance && lhs.CohDistance == rhs.CohDistance &&
+				(lhs.Share > 0.0f) == (rhs.Share > 0.0f); // species without boids do not size the grid
+		});
 
-	if ( prev.Rules.SepDistance != Rules.SepDistance || 
+	if (!speciesDistances ||
+		prev.Rules.SepDistance != Rules.SepDistance || 
 		prev.Rules.AliDistance != Rules.AliDistance || 
 		prev.Rules.CohDistance != Rules.CohDistance || 
 		prev.Boids.Width != Boids.Width || 
 		prev.Boids.Height != Boids.Height || 
-		prev.Interaction.TurnAtBorder != Interaction.TurnAtBorder)
+		prev.Interaction.TurnAtBorder != Interaction.TurnAtBorder ||
+		prev.Misc.GridStencil != Misc.GridStencil ||
+		prev.Misc.GridMorton != Misc.GridMorton)
 	{
 		result.emplace_back(Rebuild::Grid);
 	}
 
-	if (prev.Boids.Count != Boids.Count)
+	const bool speciesChanged = !std::ranges::equal(prev.Species, Species, [](const SpeciesConfig& lhs, const SpeciesConfig& rhs)
+		{
+			return lhs.Share == rhs.Share;
+		});
+
+	if (speciesChanged) // boids are spawned again, which also takes care of the count
+		result.emplace_back(Rebuild::Species);
+	else if (prev.Boids.Count != Boids.Count)
 		result.emplace_back(Rebuild::Boids);
 
-	if (prev.Boids.Texture != Boids.Texture)
+	if (prev.Boids.Texture != Boids.Texture || !std::ranges::equal(prev.Species, Species, [](const SpeciesConfig& lhs, const SpeciesConfig& rhs)
+		{
+			return lhs.Texture == rhs.Texture;
+		}))
+	{
 		result.emplace_back(Rebuild::BoidsTex);
+	}
+
+	if (prev.Interaction.PredatorCount != Interaction.PredatorCount ||
+		prev.Interaction.PredatorDistance != Interaction.PredatorDistance)
+		result.emplace_back(Rebuild::Predators);
+
+	if (prev.Obstacles.Enabled != Obstacles.Enabled ||
+		prev.Obstacles.Mask != Obstacles.Mask ||
+		prev.Obstacles.Color != Obstacles.Color ||
+		prev.Obstacles.CellSize != Obstacles.CellSize ||
+		prev.Obstacles.Circles != Obstacles.Circles ||
+		prev.Obstacles.Polygons != Obstacles.Polygons)
+	{
+		result.emplace_back(Rebuild::Obstacles);
+	}
 
 	if (prev.Color.Flags != Color.Flags ||
 		prev.Cycle.Random != Cycle.Random)
@@ -267,14 +393,15 @@ void Config::UpdateMisc()
 	Rules.AliDistance *= Rules.AliDistance;
 	Rules.CohDistance *= Rules.CohDistance;
 
+	for (SpeciesConfig& species : Species)
+	{
+		species.SepDistance *= species.SepDistance;
+		species.AliDistance *= species.AliDistance;
+		species.CohDistance *= species.CohDistance;
+	}
+
 	Interaction.PredatorDistance *= Interaction.PredatorDistance;
 	Interaction.BoidAddMouseDiff *= Interaction.BoidAddMouseDiff;
 
 	BoidHalfSize = sf::Vector2f(Boids.Width, Boids.Height) / 2.0f;
-
-	BoidSpeedInv = (Boids.SpeedMax == Boids.SpeedMin) ? 1.0f
-		: (1.0f / (Boids.SpeedMax - Boids.SpeedMin));
-
-	BoidSpeedMinSq = Boids.SpeedMin * Boids.SpeedMin;
-	BoidSpeedMaxSq = Boids.SpeedMax * Boids.SpeedMax;
 }
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <istream>
 
 #include <SFML/System/Vector2.hpp>
 #include <SFML/System/Vector3.hpp>
@@ -15,6 +16,8 @@ inline constexpr const char* RULES			= "Rules";
 inline constexpr const char* INTERACTION	= "Interaction";
 inline constexpr const char* COLOR			= "Color";
 inline constexpr const char* MISC			= "Misc";
+inline constexpr const char* SPECIES		= "Species";
+inline constexpr const char* OBSTACLES		= "Obstacles";
 
 enum ColorFlags : std::uint32_t
 {
@@ -41,6 +44,9 @@ enum class Rebuild
 	Window,
 	Camera,
 	Fluid,
+	Species,
+	Predators,
+	Obstacles,
 	Count
 };
 
@@ -79,6 +85,26 @@ struct RulesConfig
 	float			SepWeight			{2.8f};
 	float			AliWeight			{1.5f};
 	float			CohWeight			{1.8f};
+	float			AvoidWeight			{2.0f}; // separation from boids of other species
+};
+
+// the boids and rules above make up the first species, every entry in the species list adds another
+// that is given its share of the boid count
+//
+struct SpeciesConfig
+{
+	std::string		Texture				{""}; // same as the first species when empty
+	float			Share				{0.0f};
+	float			SpeedMax			{360.0f};
+	float			SpeedMin			{160.0f};
+	float			SteerMax			{4.0f};
+	float			SepDistance			{30.0f};
+	float			AliDistance			{60.0f};
+	float			CohDistance			{60.0f};
+	float			SepWeight			{2.8f};
+	float			AliWeight			{1.5f};
+	float			CohWeight			{1.8f};
+	float			AvoidWeight			{2.0f};
 };
 
 struct InteractionConfig
@@ -86,12 +112,16 @@ struct InteractionConfig
 	int				BoidAddAmount		{5};
 	float			BoidAddMouseDiff	{1.0f};
 	int				BoidRemoveAmount	{50};
+	float			BoidRemoveRadius	{64.0f};
 
 	float			SteerTowardsFactor	{0.9f};
 	float			SteerAwayFactor		{0.9f};
 
 	float			PredatorDistance	{250.0f};
 	float			PredatorFactor		{0.6f};
+	std::size_t		PredatorCount		{0}; // hunting on their own, the mouse is one more when enabled
+	float			PredatorSpeed		{300.0f};
+	sf::Vector3f	PredatorColor		{1.0f, 0.25f, 0.25f};
 
 	float			TurnMarginFactor	{0.85f};
 	float			TurnFactor			{275.0f};
@@ -101,6 +131,30 @@ struct InteractionConfig
 	bool			TurnAtBorder		{false};
 };
 
+struct ObstacleCircle
+{
+	sf::Vector2f	Position			{0.0f, 0.0f};
+	float			Radius				{0.0f};
+
+	bool operator==(const ObstacleCircle&) const = default;
+};
+
+// obstacles are given in world coordinates and are baked into a distance field with cells of the
+// given size, boids closer than the distance to any of them steer away
+//
+struct ObstaclesConfig
+{
+	std::string		Mask				{""}; // image stretched over the border, dark opaque pixels are solid
+	sf::Vector3f	Color				{0.2f, 0.2f, 0.2f};
+	float			CellSize			{8.0f};
+	float			Distance			{48.0f};
+	float			Factor				{512.0f};
+	bool			Enabled				{false};
+
+	std::vector<ObstacleCircle>				Circles;
+	std::vector<std::vector<sf::Vector2f>>	Polygons;
+};
+
 struct ColorConfig
 {
 	uint32_t		Flags				{CF_Cycle | CF_Density | CF_Velocity | CF_Rotation};
@@ -259,14 +313,37 @@ struct ColorFluidConfig
 struct MiscConfig
 {
 	int				GridExtraCells				{16};
+	std::string		GridStencil					{"auto"};
 	float			CameraZoom					{1.0f};
 	int				MaxFramerate				{200};
 	float			PhysicsUpdateFreq			{60.0f};
 	std::size_t		PolicyThreshold				{1500};
+	float			PolicyTuneInterval			{10.0f};
 
 	float			DebugUpdateFreq				{0.5f};
 	int				DebugToggleKey				{85};
 
+	std::string		RecordPath					{""};
+	std::string		ReplayPath					{""};
+
+	std::string		TrajectoryPath				{""};
+	std::size_t		TrajectoryBufferSize		{8};
+	bool			TrajectoryCompress			{true};
+
+	std::string		CapturePath					{""};
+	std::string		CaptureFormat				{"png"};
+	float			CaptureFramerate			{60.0f};
+	std::size_t		CaptureBufferSize			{4};
+	unsigned int	CaptureWidth				{1920};		// of headless captures, the window is captured otherwise
+	unsigned int	CaptureHeight				{1080};
+	std::size_t		CaptureFrames				{0};		// headless captures stop after as many, or when the replay ends
+
+	bool			PolicyAutoTune				{true};
+	bool			GridHashed					{false};
+	bool			GridIncremental				{true};
+	bool			GridMorton					{false};
+	bool			FlockTiled					{false};
+	bool			FlockSymmetric				{false};
 	bool			CameraEnabled				{false};
 	bool			VerticalSync				{true};
 	bool			DebugEnabled				{false};
@@ -279,6 +356,7 @@ public:
 	BoidsConfig			Boids;
 	RulesConfig			Rules;
 	InteractionConfig	Interaction;
+	ObstaclesConfig		Obstacles;
 	ColorConfig			Color;
 	ColorPosConfig		Positional;
 	ColorCycleConfig	Cycle;
@@ -290,12 +368,11 @@ public:
 	ColorFluidConfig	Fluid;
 	MiscConfig			Misc;
 
+	std::vector<SpeciesConfig> Species;
+
 	// Misc
 
 	sf::Vector2f	BoidHalfSize;
-	float			BoidSpeedInv				{0.0f};
-	float			BoidSpeedMinSq				{0.0f};
-	float			BoidSpeedMaxSq				{0.0f};
 	bool			LoadStatus					{false};
 
 public:
@@ -312,10 +389,14 @@ public:
 	Config();
 
 	void Load();
+	void Load(std::istream& stream);
 
 	std::vector<Rebuild> Refresh(Config& prev);
+	std::vector<Rebuild> Refresh(Config& prev, std::istream& stream);
 
 private:
+	std::vector<Rebuild> GetRebuilds(const Config& prev) const;
+
 	void UpdateMisc();
 };
 
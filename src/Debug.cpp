@@ -16,6 +16,10 @@ void Debug::SetUpdateFreq(float value)
 {
 	m_updateFreqMax = value;
 }
+void Debug::SetObstacleStatus(bool loaded)
+{
+	m_obstacleStatus = loaded;
+}
 
 void Debug::Load(const FontHolder& fontHolder)
 {
@@ -57,6 +61,7 @@ void Debug::Update(const InputHandler& inputHandler, std::size_t boidCount, std:
 	{
 		m_info =
 			"\nCONFIG STATUS: " + std::string(Config::Inst().LoadStatus ? "SUCCESS" : "FAILED TO LOAD") +
+			(m_obstacleStatus ? "" : "\nOBSTACLE MASK: FAILED TO LOAD") +
 			"\n\nBOIDS: " + std::to_string(boidCount) +
 			"\nCELLS: " + std::to_string(cellCount) +
 			"\nFPS: " + std::to_string((int)std::floorf(m_fpsCounter.GetFPS()));
@@ -69,13 +74,13 @@ void Debug::Update(const InputHandler& inputHandler, std::size_t boidCount, std:
 		util::RemoveTrailingZeroes(std::to_string(util::SetPrecision(m_updateFreq, 2))) + m_info);
 }
 
-void Debug::Draw(sf::RenderWindow& window) const
+void Debug::Draw(sf::RenderTarget& target) const
 {
 	if (!Config::Inst().Misc.DebugEnabled)
 		return;
 
-	window.draw(m_textState);
-	window.draw(m_textInfo);
+	target.draw(m_textState);
+	target.draw(m_textInfo);
 }
 
 void Debug::Toggle()
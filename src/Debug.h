@@ -3,7 +3,7 @@
 #include <string>
 
 #include <SFML/Graphics/Text.hpp>
-#include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
 
 #include "ResourceHolder.hpp"
 #include "InputHandler.h"
@@ -19,11 +19,12 @@ public:
 	[[nodiscard]] const char* GetState() const noexcept;
 
 	void SetUpdateFreq(float value);
+	void SetObstacleStatus(bool loaded);
 
 public:
 	void Load(const FontHolder& fontHolder);
 	void Update(const InputHandler& inputHandler, std::size_t boidCount, std::uint32_t cellCount, float dt);
-	void Draw(sf::RenderWindow& window) const;
+	void Draw(sf::RenderTarget& target) const;
 
 private:
 	void Toggle();
@@ -34,6 +35,7 @@ private:
 
 	bool		m_enabled		{false};
 	bool		m_refresh		{false};
+	bool		m_obstacleStatus	{true};
 
 	sf::Text	m_textState;
 	sf::Text	m_textInfo;
@@ -0,0 +1,369 @@
+#include "FrameCapture.h"
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Window/Context.hpp>
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	constexpr GLenum PIXEL_PACK_BUFFER	= 0x88EB;
+	constexpr GLenum STREAM_READ		= 0x88E1;
+	constexpr GLenum READ_ONLY			= 0x88B8;
+
+	// buffer objects are core since OpenGL 1.5 and pixel buffers since 2.1, the headers that come
+	// with the platform only declare 1.1 so they are loaded through the context
+	//
+	struct PixelBufferFunctions
+	{
+		void		(APIENTRY* genBuffers)(GLsizei, GLuint*)							{nullptr};
+		void		(APIENTRY* deleteBuffers)(GLsizei, const GLuint*)					{nullptr};
+		void		(APIENTRY* bindBuffer)(GLenum, GLuint)								{nullptr};
+		void		(APIENTRY* bufferData)(GLenum, std::ptrdiff_t, const void*, GLenum)	{nullptr};
+		void*		(APIENTRY* mapBuffer)(GLenum, GLenum)								{nullptr};
+		GLboolean	(APIENTRY* unmapBuffer)(GLenum)										{nullptr};
+	};
+
+	PixelBufferFunctions gl;
+
+	template<typename F>
+	void LoadFunction(F& function, const char* name)
+	{
+		function = reinterpret_cast<F>(sf::Context::getFunction(name));
+	}
+
+	bool LoadPixelBuffers()
+	{
+		const sf::Context* context = sf::Context::getActiveContext();
+		if (context == nullptr)
+			return false;
+
+		const sf::ContextSettings& settings = context->getSettings();
+		const bool core = settings.majorVersion > 2 || (settings.majorVersion == 2 && settings.minorVersion >= 1);
+
+		if (!core && !sf::Context::isExtensionAvailable("GL_ARB_pixel_buffer_object"))
+			return false;
+
+		LoadFunction(gl.genBuffers,		"glGenBuffers");
+		LoadFunction(gl.deleteBuffers,	"glDeleteBuffers");
+		LoadFunction(gl.bindBuffer,		"glBindBuffer");
+		LoadFunction(gl.bufferData,		"glBufferData");
+		LoadFunction(gl.mapBuffer,		"glMapBuffer");
+		LoadFunction(gl.unmapBuffer,	"glUnmapBuffer");
+
+		return gl.genBuffers && gl.deleteBuffers && gl.bindBuffer && gl.bufferData && gl.mapBuffer && gl.unmapBuffer;
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	Close();
+}
+
+bool FrameCapture::IsActive() const noexcept
+{
+	return m_active;
+}
+std::uint64_t FrameCapture::GetFrameCount() const noexcept
+{
+	return m_frameCount;
+}
+std::string FrameCapture::GetError() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_error;
+}
+
+CaptureFormat FrameCapture::ToFormat(const std::string& format)
+{
+	std::string lower = format;
+	std::transform(lower.begin(), lower.end(), lower.begin(),
+		[](unsigned char c) { return (char)std::tolower(c); });
+
+	return (lower == "raw") ? CaptureFormat::Raw : CaptureFormat::PNG;
+}
+
+void FrameCapture::Open(const std::filesystem::path& path, CaptureFormat format, const sf::Vector2u& size, std::size_t bufferSize)
+{
+	Close();
+
+	// render textures fall back to an internal context when frame buffer objects are not
+	// supported, which keeps capturing working on software implementations of OpenGL
+
+	if (!m_target.resize(size) || !m_target.setActive(true))
+		throw std::runtime_error("Capture target could not be created");
+
+	m_pixelBuffers = LoadPixelBuffers();
+
+	if (m_pixelBuffers)
+	{
+		gl.genBuffers(2, m_buffers);
+
+		for (const GLuint buffer : m_buffers)
+		{
+			gl.bindBuffer(PIXEL_PACK_BUFFER, buffer);
+			gl.bufferData(PIXEL_PACK_BUFFER, (std::ptrdiff_t)size.x * size.y * 4, nullptr, STREAM_READ);
+		}
+
+		gl.bindBuffer(PIXEL_PACK_BUFFER, 0);
+	}
+
+	std::filesystem::create_directories(path);
+
+	m_path			= path;
+	m_format		= format;
+	m_bufferSize	= std::max<std::size_t>(bufferSize, 1);
+	m_current		= 0;
+	m_hasPrevious	= false;
+	m_frameCount	= 0;
+	m_shutdown		= false;
+
+	m_error.clear();
+	m_spare.clear();
+
+	if (m_format == CaptureFormat::Raw) // one continuous rgba stream, e.g. for ffmpeg -f rawvideo
+	{
+		const std::string name = "frames_" + std::to_string(size.x) + "x" + std::to_string(size.y) + ".rgba";
+
+		m_rawFile.open(m_path / name, std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (!m_rawFile.is_open())
+			throw std::runtime_error("Capture file could not be opened: " + (m_path / name).string());
+	}
+
+	m_thread = std::jthread(&FrameCapture::ThreadLoop, this);
+	m_active = true;
+}
+
+void FrameCapture::Close()
+{
+	if (!m_active)
+		return;
+
+	if (m_hasPrevious) // last frame has not been read back yet
+	{
+		try
+		{
+			Frame frame;
+			ReadBack(1 - m_current, frame);
+			Enqueue(std::move(frame));
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_error = e.what();
+		}
+
+		m_hasPrevious = false;
+	}
+
+	if (m_pixelBuffers && m_target.setActive(true))
+		gl.deleteBuffers(2, m_buffers);
+
+	m_pixelBuffers = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_shutdown = true;
+	}
+
+	m_cv.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	m_rawFile.close();
+	m_active = false;
+}
+
+sf::RenderTarget& FrameCapture::GetTarget()
+{
+	return m_target;
+}
+
+const sf::Texture& FrameCapture::Capture()
+{
+	if (const std::string error = GetError(); !error.empty())
+		throw std::runtime_error(error);
+
+	m_target.display();
+
+	if (!m_pixelBuffers) // waits for the frame to finish
+	{
+		Frame frame;
+		ReadBack(0, frame);
+		Enqueue(std::move(frame));
+
+		return m_target.getTexture();
+	}
+
+	if (!m_target.setActive(true))
+		throw std::runtime_error("Capture target could not be activated");
+
+	// the copy is queued behind the draw calls of the frame and the call returns at once
+
+	const sf::Vector2u size = m_target.getSize();
+
+	gl.bindBuffer(PIXEL_PACK_BUFFER, m_buffers[m_current]);
+	glReadPixels(0, 0, (GLsizei)size.x, (GLsizei)size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	gl.bindBuffer(PIXEL_PACK_BUFFER, 0);
+
+	// the previous frame has been given a whole frame to finish copying, so mapping its buffer now
+	// does not wait for the commands that were just issued
+
+	if (m_hasPrevious)
+	{
+		Frame frame;
+		ReadBack(1 - m_current, frame);
+		Enqueue(std::move(frame));
+	}
+
+	m_hasPrevious = true;
+	m_current = 1 - m_current;
+
+	return m_target.getTexture();
+}
+
+void FrameCapture::ReadBack(std::size_t buffer, Frame& frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!m_spare.empty())
+		{
+			frame.pixels = std::move(m_spare.back());
+			m_spare.pop_back();
+		}
+	}
+
+	if (!m_pixelBuffers)
+	{
+		const sf::Image image = m_target.getTexture().copyToImage();
+
+		frame.size = image.getSize();
+		frame.pixels.assign(image.getPixelsPtr(), image.getPixelsPtr() + (std::size_t)frame.size.x * frame.size.y * 4);
+		frame.bottomUp = false;
+
+		return;
+	}
+
+	frame.size = m_target.getSize();
+	frame.pixels.resize((std::size_t)frame.size.x * frame.size.y * 4);
+	frame.bottomUp = true;
+
+	gl.bindBuffer(PIXEL_PACK_BUFFER, m_buffers[buffer]);
+
+	const void* data = gl.mapBuffer(PIXEL_PACK_BUFFER, READ_ONLY);
+
+	if (data != nullptr)
+	{
+		std::memcpy(frame.pixels.data(), data, frame.pixels.size());
+		gl.unmapBuffer(PIXEL_PACK_BUFFER);
+	}
+
+	gl.bindBuffer(PIXEL_PACK_BUFFER, 0);
+
+	if (data == nullptr)
+		throw std::runtime_error("Capture buffer could not be mapped");
+}
+
+void FrameCapture::Enqueue(Frame&& frame)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this]
+		{
+			return m_frames.size() < m_bufferSize;
+		});
+
+		frame.index = m_frameCount++;
+		m_frames.push(std::move(frame));
+	}
+
+	m_cv.notify_all();
+}
+
+void FrameCapture::ThreadLoop()
+{
+	while (true)
+	{
+		Frame frame;
+		bool failed = false;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]
+			{
+				return !m_frames.empty() || m_shutdown;
+			});
+
+			if (m_frames.empty() && m_shutdown)
+				break;
+
+			frame = std::move(m_frames.front());
+			m_frames.pop();
+
+			failed = !m_error.empty();
+		}
+
+		m_cv.notify_all(); // room for another frame
+
+		// once a frame is lost the rest are only drained, the capture is stopped by the next call
+
+		const bool written = failed || Encode(frame);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (!written)
+				m_error = "Capture frame " + std::to_string(frame.index) + " could not be written to " + m_path.string();
+
+			m_spare.push_back(std::move(frame.pixels));
+		}
+	}
+
+	if (m_rawFile.is_open() && !m_rawFile.flush())
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_error.empty())
+			m_error = "Capture frames could not be written to " + m_path.string();
+	}
+}
+
+bool FrameCapture::Encode(const Frame& frame)
+{
+	const std::size_t stride = (std::size_t)frame.size.x * 4;
+	const std::uint8_t* pixels = frame.pixels.data();
+
+	if (frame.bottomUp) // into the order they are shown in
+	{
+		m_flipped.resize(frame.pixels.size());
+
+		for (std::size_t y = 0; y < frame.size.y; ++y)
+			std::memcpy(&m_flipped[y * stride], &frame.pixels[(frame.size.y - 1 - y) * stride], stride);
+
+		pixels = m_flipped.data();
+	}
+
+	switch (m_format)
+	{
+		case CaptureFormat::Raw:
+		{
+			m_rawFile.write(reinterpret_cast<const char*>(pixels), (std::streamsize)(stride * frame.size.y));
+			return m_rawFile.good();
+		}
+		case CaptureFormat::PNG:
+		{
+			char name[32]{};
+			std::snprintf(name, sizeof(name), "frame_%06llu.png", (unsigned long long)frame.index);
+
+			return sf::Image(frame.size, pixels).saveToFile(m_path / name);
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <string>
+#include <vector>
+
+enum class CaptureFormat
+{
+	PNG,
+	Raw
+};
+
+// renders frames offscreen and writes them as an image sequence, the pixels of a frame are copied
+// into one of two pixel buffers on the GPU without waiting for it, and are only mapped a frame
+// later once the copy has finished, encoding is done on a background thread. falls back to a
+// synchronous readback when pixel buffers are not supported
+//
+class FrameCapture
+{
+private:
+	using Pixels = std::vector<std::uint8_t>; // rgba
+
+	struct Frame
+	{
+		std::uint64_t				index		{0};
+		sf::Vector2u				size;
+		Pixels						pixels;
+		bool						bottomUp	{false};	// rows as read from the target rather than as shown
+	};
+
+public:
+	FrameCapture() = default;
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+public:
+	[[nodiscard]] bool IsActive() const noexcept;
+	[[nodiscard]] std::uint64_t GetFrameCount() const noexcept;
+
+	// why the last frame could not be written, empty if every frame has been
+	//
+	[[nodiscard]] std::string GetError() const;
+
+	[[nodiscard]] static CaptureFormat ToFormat(const std::string& format);
+
+public:
+	// throws if the target could not be created or the output could not be opened, needs an active
+	// context, which may be one without a window
+	//
+	void Open(const std::filesystem::path& path, CaptureFormat format, const sf::Vector2u& size, std::size_t bufferSize);
+
+	// writes the frames still in flight, check the error afterwards as this never throws
+	//
+	void Close();
+
+	// target to draw the current frame to
+	//
+	sf::RenderTarget& GetTarget();
+
+	// finishes the current frame and queues the previous one for encoding, blocks if the encoder is
+	// lagging behind so that no frames are lost, throws once a frame could not be written, returns
+	// the finished frame
+	//
+	const sf::Texture& Capture();
+
+private:
+	void ReadBack(std::size_t buffer, Frame& frame);
+	void Enqueue(Frame&& frame);
+
+	void ThreadLoop();
+	bool Encode(const Frame& frame);
+
+private:
+	sf::RenderTexture		m_target;
+	unsigned int			m_buffers[2]	{0, 0};	// pixel buffer objects, read into in turns
+	std::size_t				m_current		{0};
+	bool					m_hasPrevious	{false};
+	bool					m_pixelBuffers	{false};
+	bool					m_active		{false};
+
+	std::filesystem::path	m_path;
+	CaptureFormat			m_format		{CaptureFormat::PNG};
+	std::ofstream			m_rawFile;
+
+	std::jthread			m_thread;
+	std::queue<Frame>		m_frames;
+	std::vector<Pixels>		m_spare;		// of written frames, reused rather than reallocated
+	std::size_t				m_bufferSize	{4};
+	std::uint64_t			m_frameCount	{0};
+	std::string				m_error;
+
+	mutable std::mutex		m_mutex;
+	std::condition_variable	m_cv;
+	bool					m_shutdown		{false};
+
+	// only accessed by the encoder thread
+
+	Pixels					m_flipped;
+};
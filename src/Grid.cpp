@@ -1,6 +1,9 @@
 #include "Grid.h"
 
 #include <algorithm>
+#include <bit>
+#include <climits>
+#include <stdexcept>
 
 #include "VectorUtilities.hpp"
 
@@ -10,6 +13,7 @@ void Grid::Initialize(const RectFloat& rect, const sf::Vector2f& contDims)
 {
 	m_rootRect = rect;
 	m_contDims = contDims;
+	m_stencil = ToStencil(Config::Inst().Misc.GridStencil);
 
 	float sizeMax = std::max(Config::Inst().Boids.Width, Config::Inst().Boids.Height);
 	sf::Vector2f offset = sf::Vector2f(sizeMax, sizeMax) / 2.0f;
@@ -28,10 +32,33 @@ void Grid::Initialize(const RectFloat& rect, const sf::Vector2f& contDims)
 	m_width = (int)a;
 	m_height = (int)b;
 
-	m_count = m_width * m_height;
+	const std::uint64_t count = (std::uint64_t)m_width * (std::uint64_t)m_height;
 
-	m_startIndices = std::make_unique<int[]>(m_count);
-	m_endIndices = std::make_unique<int[]>(m_count);
+	if (count >= (std::uint64_t)INT_MAX) // offsets and indices are int
+		throw std::runtime_error("Grid has too many cells: " + std::to_string(count));
+
+	m_count = (int)count;
+	m_morton = false;
+
+	if (Config::Inst().Misc.GridMorton) // z-order covers the smallest power of two square that fits the grid
+	{
+		const std::uint64_t side = std::bit_ceil((std::uint64_t)std::max(m_width, m_height));
+		const std::uint64_t mortonCount = side * side;
+
+		// coordinates are spread from 16 bits and a long grid would be mostly padding, the cells
+		// are numbered by row instead then
+
+		if (side <= (1ull << 16) && mortonCount <= count * MORTON_PADDING && mortonCount < (std::uint64_t)INT_MAX)
+		{
+			m_count = (int)mortonCount;
+			m_morton = true;
+		}
+	}
+
+	m_cells = std::make_unique<Cell[]>(m_count);
+	m_epoch = 1;
+
+	m_occupied.clear();
 }
 
 const RectFloat& Grid::GetRootRect() const noexcept
@@ -42,26 +69,94 @@ const sf::Vector2f& Grid::GetContDims() const noexcept
 {
 	return m_contDims;
 }
-const int* Grid::GetStartIndices() const noexcept
+int Grid::GetCount() const noexcept
 {
-	return m_startIndices.get();
+	return m_count;
 }
-const int* Grid::GetEndIndices() const noexcept
+int Grid::GetWidth() const noexcept
 {
-	return m_endIndices.get();
+	return m_width;
 }
-int Grid::GetCount() const noexcept
+int Grid::GetHeight() const noexcept
 {
-	return m_count;
+	return m_height;
+}
+GridStencil Grid::GetStencil() const noexcept
+{
+	return m_stencil;
 }
 
-void Grid::SetStartIndex(int index, int value)
+GridCell Grid::GetCell(int index) const noexcept
 {
-	m_startIndices[index] = value;
+	const Cell& cell = m_cells[index];
+
+	if (cell.epoch != m_epoch) // not written since the last reset
+		return GridCell{};
+
+	return GridCell{ cell.start, cell.end };
 }
-void Grid::SetEndIndex(int index, int value)
+
+GridStencil Grid::ToStencil(const std::string& stencil)
 {
-	m_endIndices[index] = value;
+	if (stencil == "quadrant")	return GridStencil::Quadrant;
+	if (stencil == "3x3")		return GridStencil::Cells3x3;
+	if (stencil == "5x5")		return GridStencil::Cells5x5;
+
+	return GridStencil::Auto;
+}
+
+void Grid::Insert(int index)
+{
+	Cell& cell = m_cells[index];
+
+	if (cell.epoch != m_epoch)
+	{
+		cell.epoch	= m_epoch;
+		cell.end	= 0;
+
+		m_occupied.push_back(index);
+	}
+
+	++cell.end;
+}
+void Grid::Scan()
+{
+	// few occupied cells are sorted rather than searched for among all cells, the boids are to end
+	// up in cell order either way
+
+	int total = 0;
+
+	const auto scan = [this, &total](int index)
+		{
+			Cell& cell = m_cells[index];
+
+			total += cell.end;
+			cell.start = cell.end = total;
+		};
+
+	if (m_occupied.size() < (std::size_t)m_count / 16)
+	{
+		std::ranges::sort(m_occupied);
+
+		for (int index : m_occupied)
+			scan(index);
+	}
+	else
+	{
+		for (int index = 0; index < m_count; ++index)
+		{
+			if (m_cells[index].epoch == m_epoch)
+				scan(index);
+		}
+	}
+}
+int Grid::Place(int index)
+{
+	return --m_cells[index].start;
+}
+void Grid::Set(int index, int start, int end)
+{
+	m_cells[index] = Cell{ start, end, m_epoch };
 }
 
 sf::Vector2f Grid::RelativePos(const sf::Vector2f& position) const
@@ -81,11 +176,53 @@ int Grid::AtPos(int x, int y) const noexcept
 	x = util::Wrap(x, 0, m_width);
 	y = util::Wrap(y, 0, m_height);
 
+	if (m_morton)
+		return (int)(SpreadBits((std::uint32_t)x) | (SpreadBits((std::uint32_t)y) << 1));
+
 	return x + y * m_width;
 }
 
+sf::Vector2i Grid::CellPos(int index) const noexcept
+{
+	if (m_morton)
+		return sf::Vector2i((int)CompactBits((std::uint32_t)index), (int)CompactBits((std::uint32_t)index >> 1));
+
+	return sf::Vector2i(index % m_width, index / m_width);
+}
+
 void Grid::ResetBuffers()
 {
-	std::ranges::fill_n(m_startIndices.get(), m_count, -1);
-	std::ranges::fill_n(m_endIndices.get(), m_count, -1);
+	m_occupied.clear();
+
+	if (++m_epoch == 0) // wrapped around, old stamps could match again
+	{
+		for (int index = 0; index < m_count; ++index)
+			m_cells[index].epoch = 0;
+
+		m_epoch = 1;
+	}
+}
+std::uint32_t Grid::SpreadBits(std::uint32_t value) noexcept
+{
+	// inserts a zero bit between each of the lower 16 bits
+
+	value &= 0x0000FFFF;
+	value = (value | (value << 8)) & 0x00FF00FF;
+	value = (value | (value << 4)) & 0x0F0F0F0F;
+	value = (value | (value << 2)) & 0x33333333;
+	value = (value | (value << 1)) & 0x55555555;
+
+	return value;
+}
+std::uint32_t Grid::CompactBits(std::uint32_t value) noexcept
+{
+	// removes every other bit, the inverse of spread bits
+
+	value &= 0x55555555;
+	value = (value | (value >> 1)) & 0x33333333;
+	value = (value | (value >> 2)) & 0x0F0F0F0F;
+	value = (value | (value >> 4)) & 0x00FF00FF;
+	value = (value | (value >> 8)) & 0x0000FFFF;
+
+	return value;
 }
\ No newline at end of file
@@ -1,13 +1,33 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <SFML/System/Vector2.hpp>
 
 #include "Rectangle.hpp"
 
+enum class GridStencil
+{
+	Auto,		// cells sized after separation, rings as needed by the larger rules
+	Quadrant,	// cells twice the largest radius, current cell and the 3 closest by quadrant
+	Cells3x3,	// cells the size of the largest radius
+	Cells5x5	// cells half the size of the largest radius
+};
+
+struct GridCell
+{
+	int start	{0};
+	int end		{0}; // one past the last, empty when equal to start
+};
+
 class Grid
 {
+public:
+	static constexpr int MAX_RINGS = 3; // largest search stencil is 7x7 cells
+	static constexpr std::uint64_t MORTON_PADDING = 2; // most cells z-order may add in padding, as a multiple of the grid
+
 public:
 	Grid() = default;
 
@@ -22,12 +42,27 @@ public:
 public:
 	[[nodiscard]] const RectFloat& GetRootRect() const noexcept;
 	[[nodiscard]] const sf::Vector2f& GetContDims() const noexcept;
-	[[nodiscard]] const int* GetStartIndices() const noexcept;
-	[[nodiscard]] const int* GetEndIndices() const noexcept;
 	[[nodiscard]] int GetCount() const noexcept;
+	[[nodiscard]] int GetWidth() const noexcept;
+	[[nodiscard]] int GetHeight() const noexcept;
+	[[nodiscard]] GridStencil GetStencil() const noexcept;
 
-	void SetStartIndex(int index, int value);
-	void SetEndIndex(int index, int value);
+	[[nodiscard]] GridCell GetCell(int index) const noexcept;
+
+	[[nodiscard]] static GridStencil ToStencil(const std::string& stencil);
+
+	// cells are built as a counting sort, every boid is first inserted to count the cells, the counts
+	// are then scanned into the end offset of every cell and placing a boid moves the offset of its
+	// cell back by one, boids placed in reverse leaves every cell at its start offset in stable order,
+	// only the cells that were inserted into are visited unless most cells are occupied
+	//
+	void Insert(int index);
+	void Scan();
+	[[nodiscard]] int Place(int index);
+
+	// sets the range of a cell when the boids are already sorted, cells that are not set are empty
+	//
+	void Set(int index, int start, int end);
 
 public:
 	[[nodiscard]] sf::Vector2f RelativePos(const sf::Vector2f& position) const;
@@ -35,16 +70,37 @@ public:
 	[[nodiscard]] int AtPos(const sf::Vector2i& position) const noexcept;
 	[[nodiscard]] int AtPos(int x, int y) const noexcept;
 
+	// coordinates of the cell at the index, the inverse of AtPos within the grid
+	//
+	[[nodiscard]] sf::Vector2i CellPos(int index) const noexcept;
+
 public:
+	// every cell is stamped with the epoch it was last written in and cells with an older stamp are
+	// empty, so clearing the grid only advances the epoch
+	//
 	void ResetBuffers();
 
+private:
+	[[nodiscard]] static std::uint32_t SpreadBits(std::uint32_t value) noexcept;
+	[[nodiscard]] static std::uint32_t CompactBits(std::uint32_t value) noexcept;
+
 private:
 	RectFloat		m_rootRect;
 	sf::Vector2f	m_contDims;
+	GridStencil		m_stencil	{GridStencil::Auto};
+
+	struct Cell
+	{
+		int				start	{0};
+		int				end		{0}; // count of the cell until scanned
+		std::uint32_t	epoch	{0};
+	};
 
-	std::unique_ptr<int[]> m_startIndices;
-	std::unique_ptr<int[]> m_endIndices;
+	std::unique_ptr<Cell[]> m_cells;
+	std::vector<int>		m_occupied; // cells inserted into this epoch
+	std::uint32_t			m_epoch		{1};
 
 	int m_width{0}, m_height{0}, m_count{0};
+	bool m_morton{false}; // cells are numbered in z-order so that neighbouring cells are close in memory
 };
 
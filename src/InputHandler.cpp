@@ -31,6 +31,19 @@ bool InputHandler::GetKeyReleased(sf::Keyboard::Key key) const
 	return !m_currKeyState[static_cast<int>(key)] && m_prevKeyState[static_cast<int>(key)];
 }
 
+bool InputHandler::GetButtonDown(sf::Mouse::Button button) const
+{
+	return m_currButtonState[static_cast<int>(button)];
+}
+bool InputHandler::GetKeyDown(sf::Keyboard::Key key) const
+{
+	return m_currKeyState[static_cast<int>(key)];
+}
+float InputHandler::GetScrollDelta() const
+{
+	return m_scrollDelta;
+}
+
 void InputHandler::Update(float dt)
 {
 	m_scrollDelta = 0.0f;
@@ -44,11 +57,6 @@ void InputHandler::Update(float dt)
 		currState = sf::Mouse::isButtonPressed(static_cast<sf::Mouse::Button>(i));
 	}
 
-	for (std::uint32_t i = 0; i < sf::Mouse::ButtonCount; ++i)
-	{
-		m_heldButtonTime[i] = m_currButtonState[i] ? (m_heldButtonTime[i] + dt) : 0.0f;
-	}
-
 	for (uint32_t i = 0; i < sf::Keyboard::KeyCount; ++i)
 	{
 		bool& prevState = m_prevKeyState[i];
@@ -58,10 +66,26 @@ void InputHandler::Update(float dt)
 		currState = sf::Keyboard::isKeyPressed(static_cast<sf::Keyboard::Key>(i));
 	}
 
-	for (std::uint32_t i = 0; i < sf::Keyboard::KeyCount; ++i)
+	UpdateHeldTimes(dt);
+}
+
+void InputHandler::Update(float dt, const bool* buttonStates, const bool* keyStates, float scrollDelta)
+{
+	m_scrollDelta = scrollDelta;
+
+	for (uint32_t i = 0; i < sf::Mouse::ButtonCount; ++i)
 	{
-		m_heldKeyTime[i] = m_currKeyState[i] ? (m_heldKeyTime[i] + dt) : 0.0f;
+		m_prevButtonState[i] = m_currButtonState[i];
+		m_currButtonState[i] = buttonStates[i];
+	}
+
+	for (uint32_t i = 0; i < sf::Keyboard::KeyCount; ++i)
+	{
+		m_prevKeyState[i] = m_currKeyState[i];
+		m_currKeyState[i] = keyStates[i];
 	}
+
+	UpdateHeldTimes(dt);
 }
 
 void InputHandler::HandleEvent(const sf::Event& event)
@@ -71,3 +95,16 @@ void InputHandler::HandleEvent(const sf::Event& event)
 		m_scrollDelta = mouseWheelScrolled->delta;
 	}
 }
+
+void InputHandler::UpdateHeldTimes(float dt)
+{
+	for (std::uint32_t i = 0; i < sf::Mouse::ButtonCount; ++i)
+	{
+		m_heldButtonTime[i] = m_currButtonState[i] ? (m_heldButtonTime[i] + dt) : 0.0f;
+	}
+
+	for (std::uint32_t i = 0; i < sf::Keyboard::KeyCount; ++i)
+	{
+		m_heldKeyTime[i] = m_currKeyState[i] ? (m_heldKeyTime[i] + dt) : 0.0f;
+	}
+}
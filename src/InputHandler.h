@@ -42,12 +42,25 @@ public:
 	bool GetKeyPressed(sf::Keyboard::Key key) const;
 	bool GetKeyReleased(sf::Keyboard::Key key) const;
 
+	bool GetButtonDown(sf::Mouse::Button button) const;
+	bool GetKeyDown(sf::Keyboard::Key key) const;
+	float GetScrollDelta() const;
+
 public:
 	// call at start of loop before poll event
 	//
 	void Update(float dt);
+
+	// same as update but takes the device states from the given arrays instead of polling them,
+	// arrays are expected to be of size sf::Mouse::ButtonCount and sf::Keyboard::KeyCount
+	//
+	void Update(float dt, const bool* buttonStates, const bool* keyStates, float scrollDelta);
+
 	void HandleEvent(const sf::Event& event);
 
+private:
+	void UpdateHeldTimes(float dt);
+
 private: // VARIABLES
 	float	m_scrollDelta		{0.0f};
 	float	m_heldThreshold		{0.0f};
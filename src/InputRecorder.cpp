@@ -0,0 +1,288 @@
+#include "InputRecorder.h"
+
+#include <sstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+
+#include "CommonUtilities.hpp"
+
+#include "Config.h"
+
+namespace
+{
+	template<typename T>
+	void WriteValue(std::ostream& stream, const T& value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadValue(std::istream& stream, T& value)
+	{
+		return (bool)stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	void WriteString(std::ostream& stream, const std::string& str)
+	{
+		WriteValue(stream, (std::uint32_t)str.size());
+		stream.write(str.data(), (std::streamsize)str.size());
+	}
+
+	bool ReadString(std::istream& stream, std::string& str)
+	{
+		std::uint32_t size = 0;
+		if (!ReadValue(stream, size))
+			return false;
+
+		str.resize(size);
+		return (bool)stream.read(str.data(), (std::streamsize)size);
+	}
+}
+
+void InputRecorder::Initialize()
+{
+	const MiscConfig& misc = Config::Inst().Misc;
+
+	if (!misc.ReplayPath.empty())
+		OpenReplay(misc.ReplayPath);
+	else if (!misc.RecordPath.empty())
+		OpenRecord(misc.RecordPath);
+}
+
+void InputRecorder::OpenReplay(const std::string& path)
+{
+	m_file.open(path, std::ios::in | std::ios::binary);
+
+	if (!m_file.is_open())
+		throw std::runtime_error("Replay file could not be opened: " + path);
+
+	std::uint32_t magic = 0, version = 0;
+	std::uint64_t seed = 0;
+
+	if (!ReadValue(m_file, magic) || !ReadValue(m_file, version) || !ReadValue(m_file, seed) || !ReadString(m_file, m_config))
+		throw std::runtime_error("Replay file is corrupt: " + path);
+
+	if (magic != MAGIC || version != VERSION)
+		throw std::runtime_error("Replay file has an unsupported format: " + path);
+
+	util::Seed(seed);
+
+	if (!m_config.empty())
+	{
+		std::istringstream stream(m_config);
+		Config::Inst().Load(stream);
+	}
+
+	m_mode = RecordMode::Replay;
+}
+
+void InputRecorder::OpenRecord(const std::string& path)
+{
+	m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!m_file.is_open())
+		throw std::runtime_error("Record file could not be opened: " + path);
+
+	std::random_device rd;
+	const std::uint64_t seed = ((std::uint64_t)rd() << 32) | (std::uint64_t)rd();
+
+	util::Seed(seed);
+
+	m_config = ReadConfigFile();
+
+	WriteValue(m_file, MAGIC);
+	WriteValue(m_file, VERSION);
+	WriteValue(m_file, seed);
+	WriteString(m_file, m_config);
+
+	m_mode = RecordMode::Record;
+}
+
+RecordMode InputRecorder::GetMode() const noexcept
+{
+	return m_mode;
+}
+bool InputRecorder::IsRecording() const noexcept
+{
+	return m_mode == RecordMode::Record;
+}
+bool InputRecorder::IsReplaying() const noexcept
+{
+	return m_mode == RecordMode::Replay;
+}
+bool InputRecorder::IsFinished() const noexcept
+{
+	return m_finished;
+}
+
+const InputHandler& InputRecorder::GetInput() const noexcept
+{
+	return m_input;
+}
+const sf::Vector2f& InputRecorder::GetMousePosition() const noexcept
+{
+	return m_tick.mousePos;
+}
+float InputRecorder::GetDeltaTime() const noexcept
+{
+	return m_tick.dt;
+}
+
+bool InputRecorder::Update(const InputHandler& inputHandler, const sf::Vector2f& mousePos, float dt)
+{
+	switch (m_mode)
+	{
+		case RecordMode::Record:
+		{
+			Sample(inputHandler, mousePos, dt);
+			WriteTick(m_tick);
+
+			break;
+		}
+		case RecordMode::Replay:
+		{
+			if (m_finished || !ReadTick(m_tick))
+			{
+				m_finished = true;
+				return false;
+			}
+
+			break;
+		}
+		default:
+		{
+			Sample(inputHandler, mousePos, dt);
+			break;
+		}
+	}
+
+	Apply();
+
+	return true;
+}
+
+std::vector<Rebuild> InputRecorder::RefreshConfig(Config& prev)
+{
+	switch (m_mode)
+	{
+		case RecordMode::Record:
+		{
+			std::string config = ReadConfigFile();
+
+			if (config.empty()) // nothing to record, behave as usual
+				return Config::Inst().Refresh(prev);
+
+			if (config != m_config)
+			{
+				m_config = std::move(config);
+				m_configChanged = true;
+			}
+
+			std::istringstream stream(m_config);
+			return Config::Inst().Refresh(prev, stream);
+		}
+		case RecordMode::Replay:
+		{
+			if ((m_tick.flags & TF_Config) != TF_Config) // config did not change before this tick
+				return {};
+
+			m_config = m_tick.config;
+
+			std::istringstream stream(m_config);
+			return Config::Inst().Refresh(prev, stream);
+		}
+		default:
+		{
+			return Config::Inst().Refresh(prev);
+		}
+	}
+}
+
+void InputRecorder::Sample(const InputHandler& inputHandler, const sf::Vector2f& mousePos, float dt)
+{
+	m_tick = Tick{};
+
+	m_tick.dt			= dt;
+	m_tick.mousePos		= mousePos;
+	m_tick.scrollDelta	= inputHandler.GetScrollDelta();
+
+	for (std::uint32_t i = 0; i < sf::Mouse::ButtonCount; ++i)
+	{
+		if (inputHandler.GetButtonDown(static_cast<sf::Mouse::Button>(i)))
+			m_tick.buttons |= (std::uint8_t)(1 << i);
+	}
+
+	for (std::uint32_t i = 0; i < sf::Keyboard::KeyCount; ++i)
+	{
+		if (inputHandler.GetKeyDown(static_cast<sf::Keyboard::Key>(i)))
+			m_tick.keys[i / 8] |= (std::uint8_t)(1 << (i % 8));
+	}
+
+	if (m_configChanged)
+	{
+		m_tick.flags |= TF_Config;
+		m_tick.config = m_config;
+
+		m_configChanged = false;
+	}
+}
+
+void InputRecorder::Apply()
+{
+	// the input of the simulation is stepped once per tick from the sampled states, so presses and
+	// held times are the same whether they come from the frame or the file
+
+	bool buttonStates[sf::Mouse::ButtonCount]	= {false};
+	bool keyStates[sf::Keyboard::KeyCount]		= {false};
+
+	for (std::uint32_t i = 0; i < sf::Mouse::ButtonCount; ++i)
+		buttonStates[i] = (m_tick.buttons & (1 << i)) != 0;
+
+	for (std::uint32_t i = 0; i < sf::Keyboard::KeyCount; ++i)
+		keyStates[i] = (m_tick.keys[i / 8] & (1 << (i % 8))) != 0;
+
+	m_input.Update(m_tick.dt, buttonStates, keyStates, m_tick.scrollDelta);
+}
+
+void InputRecorder::WriteTick(const Tick& tick)
+{
+	WriteValue(m_file, tick.dt);
+	WriteValue(m_file, tick.mousePos.x);
+	WriteValue(m_file, tick.mousePos.y);
+	WriteValue(m_file, tick.scrollDelta);
+	WriteValue(m_file, tick.buttons);
+	WriteValue(m_file, tick.keys);
+	WriteValue(m_file, tick.flags);
+
+	if ((tick.flags & TF_Config) == TF_Config)
+		WriteString(m_file, tick.config);
+}
+
+bool InputRecorder::ReadTick(Tick& tick)
+{
+	tick = Tick{};
+
+	const bool success =
+		ReadValue(m_file, tick.dt) &&
+		ReadValue(m_file, tick.mousePos.x) &&
+		ReadValue(m_file, tick.mousePos.y) &&
+		ReadValue(m_file, tick.scrollDelta) &&
+		ReadValue(m_file, tick.buttons) &&
+		ReadValue(m_file, tick.keys) &&
+		ReadValue(m_file, tick.flags);
+
+	if (success && (tick.flags & TF_Config) == TF_Config)
+		return ReadString(m_file, tick.config);
+
+	return success;
+}
+
+std::string InputRecorder::ReadConfigFile()
+{
+	std::ifstream file(FILE_NAME, std::ios::in | std::ios::binary);
+	if (!file.good())
+		return {};
+
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Window/Keyboard.hpp>
+#include <SFML/Window/Mouse.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "InputHandler.h"
+
+class Config;
+
+enum class Rebuild;
+
+enum class RecordMode
+{
+	None,
+	Record,
+	Replay
+};
+
+// records the input state and mouse world position of every fixed tick to a file, or feeds them
+// back from one, the simulation only reads its input from here so that an interaction session can
+// be reproduced exactly no matter how many ticks every rendered frame ran, even without a window
+//
+class InputRecorder
+{
+private:
+	static constexpr std::uint32_t MAGIC		= 0x43455242; // "BREC"
+	static constexpr std::uint32_t VERSION		= 2;
+
+	static constexpr std::size_t KEY_BYTES		= (sf::Keyboard::KeyCount + 7) / 8;
+
+	enum TickFlags : std::uint8_t
+	{
+		TF_None		= 0,
+		TF_Config	= 1 << 0,
+	};
+
+	struct Tick
+	{
+		float			dt				{0.0f};
+		sf::Vector2f	mousePos;
+		float			scrollDelta		{0.0f};
+		std::uint8_t	buttons			{0};
+		std::uint8_t	keys[KEY_BYTES]	{};
+		std::uint8_t	flags			{TF_None};
+		std::string		config;
+	};
+
+public:
+	InputRecorder() = default;
+
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder& operator=(const InputRecorder&) = delete;
+
+	// opens the record or replay file given by the config, should be called before anything
+	// that depends on randomness or the config has been initialized
+	//
+	void Initialize();
+
+	// seeds the randomness and loads the config of the recording, throws if it cannot be read
+	//
+	void OpenReplay(const std::string& path);
+	void OpenRecord(const std::string& path);
+
+public:
+	[[nodiscard]] RecordMode GetMode() const noexcept;
+	[[nodiscard]] bool IsRecording() const noexcept;
+	[[nodiscard]] bool IsReplaying() const noexcept;
+	[[nodiscard]] bool IsFinished() const noexcept;
+
+	// input and mouse world position of the current tick, which is what the simulation should read
+	//
+	[[nodiscard]] const InputHandler& GetInput() const noexcept;
+	[[nodiscard]] const sf::Vector2f& GetMousePosition() const noexcept;
+	[[nodiscard]] float GetDeltaTime() const noexcept;
+
+public:
+	// call once before every fixed tick, samples the input of the frame and records it, or reads
+	// the next tick when replaying, returns false once the replay has run out of ticks
+	//
+	bool Update(const InputHandler& inputHandler, const sf::Vector2f& mousePos, float dt);
+
+	// reloads the config from file when recording, or from the recorded tick when replaying, a
+	// change while recording is stored with the next tick
+	//
+	std::vector<Rebuild> RefreshConfig(Config& prev);
+
+private:
+	void Sample(const InputHandler& inputHandler, const sf::Vector2f& mousePos, float dt);
+	void Apply();
+
+	void WriteTick(const Tick& tick);
+	bool ReadTick(Tick& tick);
+
+	static std::string ReadConfigFile();
+
+private:
+	RecordMode		m_mode			{RecordMode::None};
+	std::fstream	m_file;
+
+	Tick			m_tick;
+	InputHandler	m_input;
+	bool			m_finished		{false};
+
+	std::string		m_config;
+	bool			m_configChanged	{false};
+};
@@ -6,6 +6,7 @@
 #include "Camera.h"
 #include "Window.h"
 #include "InputHandler.h"
+#include "InputRecorder.h"
 #include "SFMLLoaders.hpp"
 
 #include "PolicySelect.h"
@@ -19,22 +20,23 @@ MainState::MainState(Context context)
 	, m_window(&context.GetWindow())
 	, m_camera(&context.GetCamera())
 	, m_inputHandler(&context.GetInputHandler())
+	, m_inputRecorder(&context.GetInputRecorder())
 	, m_boids(Config::Inst().Boids.Count) {}
 
-void MainState::Initialize()
+void MainState::Initialize(const sf::Vector2u& size)
 {
-	m_vertices.setPrimitiveType(sf::PrimitiveType::Triangles);
+	m_size = size;
 
-	auto loadBoidTex = GetContext().GetTextureHolder().AcquireAsync(TextureID::Boid,
-		FromFile<sf::Texture>(RESOURCE_FOLDER + Config::Inst().Boids.Texture));
+	m_vertices.setPrimitiveType(sf::PrimitiveType::Triangles);
 
 	auto loadFont = GetContext().GetFontHolder().AcquireAsync(FontID::F8Bit, 
 		OpenFile<sf::Font>(RESOURCE_FOLDER + std::string("8bit.ttf")));
 
-	loadBoidTex.wait();
+	LoadBoidTextures(res::LoadStrategy::New);
+
 	loadFont.wait();
 
-	m_background.Load(GetContext().GetTextureHolder(), sf::Vector2i(m_window->getSize()));
+	m_background.Load(GetContext().GetTextureHolder(), sf::Vector2i(m_size));
 	m_debug.Load(GetContext().GetFontHolder());
 
 #if defined(_WIN32)
@@ -43,17 +45,23 @@ void MainState::Initialize()
 	m_audioMeter = std::make_unique<AudioMeterEmpty>();
 #endif
 
-	m_border = m_window->GetBorder();
+	m_border = RectFloat(0.0f, 0.0f, (float)m_size.x, (float)m_size.y);
 	m_minDistance = GetMinDistance();
+	m_cellSize = GetCellSize();
 
 	m_audioMeter->Initialize();
-	m_fluid.Initialize(m_window->getSize());
-	m_grid.Initialize(GetGridBorder(), sf::Vector2f(m_minDistance, m_minDistance) * 2.0f);
+	m_fluid.Initialize(m_size);
+	m_grid.Initialize(GetGridBorder(), sf::Vector2f(m_cellSize, m_cellSize));
 
 	m_fluidMousePosPrev = m_fluidMousePos = sf::Vector2i(m_camera->
 		GetMouseWorldPosition(*m_window)) / Config::Inst().Fluid.Scale;
 
-	m_grid.Initialize(GetGridBorder(), sf::Vector2f(m_minDistance, m_minDistance) * 2.0f);
+	m_spatialHash.Initialize(sf::Vector2f(m_cellSize, m_cellSize));
+
+	m_predators.Initialize(m_border);
+	m_predators.Resize(Config::Inst().Interaction.PredatorCount, m_border);
+
+	LoadObstacles();
 
 	m_boids.Reserve(Config::Inst().Boids.Count);
 	for (std::size_t i = 0; i < Config::Inst().Boids.Count; ++i)
@@ -68,19 +76,31 @@ void MainState::Initialize()
 	UpdateVertices();
 	UpdatePolicy();
 
-	SetBoidTexture(loadBoidTex.get());
+	if (!Config::Inst().Misc.TrajectoryPath.empty())
+	{
+		m_trajectory.Open(
+			Config::Inst().Misc.TrajectoryPath, 
+			Config::Inst().Misc.TrajectoryBufferSize, 
+			Config::Inst().Misc.TrajectoryCompress);
+	}
 }
 
 bool MainState::HandleEvent(const sf::Event& event)
 {
-	if (event.is<sf::Event::Resized>())
+	if (const auto* resized = event.getIf<sf::Event::Resized>())
 	{
-		m_background.LoadProperties(sf::Vector2i(m_window->getSize()));
+		m_size = resized->size;
+
+		m_background.LoadProperties(sf::Vector2i(m_size));
 
-		m_fluid.Initialize(m_window->getSize());
-		m_border = m_window->GetBorder();
+		m_fluid.Initialize(m_size);
+		m_border = RectFloat(0.0f, 0.0f, (float)m_size.x, (float)m_size.y);
 
-		m_grid.Initialize(GetGridBorder(), sf::Vector2f(m_minDistance, m_minDistance) * 2.0f);
+		m_grid.Initialize(GetGridBorder(), sf::Vector2f(m_cellSize, m_cellSize));
+
+		m_predators.Initialize(m_border); // binned within the border
+
+		LoadObstacles(); // stretched over the border
 	}
 
     return false;
@@ -88,16 +108,11 @@ bool MainState::HandleEvent(const sf::Event& event)
 
 bool MainState::PreUpdate(float dt)
 {
-    m_debug.Update(*m_inputHandler, m_boids.GetSize(), m_grid.GetCount(), dt);
+	const int cellCount = Config::Inst().Misc.GridHashed ? m_spatialHash.GetCount() : m_grid.GetCount();
+    m_debug.Update(*m_inputHandler, m_boids.GetSize(), cellCount, dt);
 
-	if (m_debug.GetRefresh()) // time to refresh data
-	{
-		Config prev = Config::Inst();
-		for (Rebuild rebuild : Config::Inst().Refresh(prev))
-		{
-			PerformRebuild(rebuild, prev);
-		}
-	}
+	if (m_debug.GetRefresh() && !m_inputRecorder->IsReplaying()) // time to refresh data, replays refresh at their recorded tick
+		RefreshConfig();
 
     return true;
 }
@@ -106,116 +121,250 @@ bool MainState::Update(float dt)
 {
 	m_audioMeter->Update(dt);
 
+    return true;
+}
+
+bool MainState::FixedUpdate(float dt)
+{
+	// everything that the input changes about the simulation happens per tick and reads the input
+	// of the recorder, so that a recorded session replays the same
+
+	if (m_inputRecorder->IsReplaying())
+		RefreshConfig();
+
+	const InputHandler& input = m_inputRecorder->GetInput();
+
 	m_mousePosPrev = m_mousePos;
-	m_mousePos = sf::Vector2f(m_camera->GetMouseWorldPosition(*m_window));
+	m_mousePos = m_inputRecorder->GetMousePosition();
 
 	InteractionFluid(dt);
 
-	InteractionAddBoids();
+	InteractionAddBoids(input);
 
-	InteractionRemoveBoids();
+	InteractionRemoveBoids(input);
 
-	InteractionAddImpulse();
+	InteractionAddImpulse(input);
 
 	UpdateImpulses(dt);
 
-    return true;
-}
+	m_predators.Update(m_boids, m_border, dt);
 
-bool MainState::FixedUpdate(float dt)
-{
-	m_grid.ResetBuffers();
+	if (Config::Inst().Misc.GridHashed)
+		Flock(m_spatialHash, dt);
+	else
+		Flock(m_grid, dt);
 
-	m_boids.PreUpdate(m_grid);
-	m_boids.Sort();
-	m_boids.UpdateCells(m_grid);
-	m_boids.Interaction(*m_inputHandler, m_mousePos, dt);
-	m_boids.Flock(m_grid, m_policy);
 	m_boids.Update(m_border, m_impulses, dt);
 	m_boids.UpdateColors(m_border, m_fluid, m_audioMeter.get(), m_impulses);
 
+	m_trajectory.Write(m_boids);
+
     return true;
 }
 
 bool MainState::PostUpdate([[maybe_unused]] float dt, float interp)
 {
-	m_boids.UpdateVertices(m_vertices, interp, m_policy);
+	const Policy verticesPolicy = m_policyTuner.Begin(PolicyStage::UpdateVertices);
+	m_boids.UpdateVertices(m_vertices, interp, verticesPolicy);
+	m_policyTuner.End(PolicyStage::UpdateVertices);
+
+	m_predators.UpdateVertices(interp);
 
     return true;
 }
 
-void MainState::Draw()
+void MainState::Draw(sf::RenderTarget& target)
 {
 	sf::RenderStates renderStates;
-	renderStates.texture = m_boidTexture;
+	renderStates.coordinateType = sf::CoordinateType::Normalized; // shared by the textures of every species
+
+	m_background.Draw(target);
+	m_obstacles.Draw(target);
+
+	for (std::size_t i = 0; i < m_boids.GetSpeciesCount(); ++i) // one draw call per species
+	{
+		const SpeciesSegment segment = m_boids.GetSegment(i);
+
+		if (segment.start == segment.end)
+			continue;
 
-	m_background.Draw(*m_window);
-	m_window->draw(m_vertices, renderStates);
-	m_debug.Draw(*m_window);
+		renderStates.texture = (i < m_boidTextures.size()) ? m_boidTextures[i] : m_boidTextures.front();
+
+		target.draw(&m_vertices[segment.start * 6], (segment.end - segment.start) * 6, sf::PrimitiveType::Triangles, renderStates);
+	}
+
+	renderStates.texture = m_boidTextures.front();
+	m_predators.Draw(target, renderStates);
+
+	m_debug.Draw(target);
 }
 
-RectFloat MainState::GetGridBorder() const
+RectFloat MainState::GetGridBorder(const RectFloat& border, float minDistance)
 {
 	if (!Config::Inst().Interaction.TurnAtBorder)
-		return m_border;
+		return border;
 
-	return m_border + RectFloat(
-		-m_minDistance * Config::Inst().Misc.GridExtraCells,
-		-m_minDistance * Config::Inst().Misc.GridExtraCells,
-		+m_minDistance * Config::Inst().Misc.GridExtraCells * 2.0f,
-		+m_minDistance * Config::Inst().Misc.GridExtraCells * 2.0f);
+	return border + RectFloat(
+		-minDistance * Config::Inst().Misc.GridExtraCells,
+		-minDistance * Config::Inst().Misc.GridExtraCells,
+		+minDistance * Config::Inst().Misc.GridExtraCells * 2.0f,
+		+minDistance * Config::Inst().Misc.GridExtraCells * 2.0f);
 }
 
-float MainState::GetMinDistance() const
+float MainState::GetMinDistance()
 {
-	return std::sqrtf(std::max({ Config::Inst().Rules.SepDistance, Config::Inst().Rules.AliDistance, Config::Inst().Rules.CohDistance }));
+	const Config& config = Config::Inst();
+
+	float distance = std::max({ config.Rules.SepDistance, config.Rules.AliDistance, config.Rules.CohDistance });
+
+	for (const SpeciesConfig& species : config.Species) // the grid is shared by every species that has boids
+	{
+		if (species.Share > 0.0f)
+			distance = std::max({ distance, species.SepDistance, species.AliDistance, species.CohDistance });
+	}
+
+	return std::sqrtf(distance);
 }
 
-void MainState::SetBoidTexture(sf::Texture& texture)
+float MainState::GetCellSize()
 {
-	m_boidTexture = &texture;
-
-	const sf::Vector2u texSize = m_boidTexture->getSize();
-	for (std::size_t i = 0; i < m_boids.GetSize(); ++i)
+	switch (Grid::ToStencil(Config::Inst().Misc.GridStencil))
 	{
-		const std::size_t v = i * 6;
+		case GridStencil::Quadrant: return GetMinDistance() * 2.0f;
+		case GridStencil::Cells3x3: return GetMinDistance();
+		case GridStencil::Cells5x5: return GetMinDistance() / 2.0f;
+		default:
+		{
+			// cells are sized after the separation radius so that separation only has to search the
+			// closest ring of cells, the larger rules search as many rings as their radius needs
+
+			float sepDistance = Config::Inst().Rules.SepDistance;
+
+			for (const SpeciesConfig& species : Config::Inst().Species)
+			{
+				if (species.Share > 0.0f)
+					sepDistance = std::max(sepDistance, species.SepDistance);
+			}
 
-		m_vertices[v + 0].texCoords = sf::Vector2f(0.0f,				0.0f);
-		m_vertices[v + 1].texCoords = sf::Vector2f((float)texSize.x,	0.0f);
-		m_vertices[v + 2].texCoords = sf::Vector2f(0.0f,				(float)texSize.y);
-		m_vertices[v + 3].texCoords = sf::Vector2f((float)texSize.x,	0.0f);
-		m_vertices[v + 4].texCoords = sf::Vector2f(0.0f,				(float)texSize.y);
-		m_vertices[v + 5].texCoords = sf::Vector2f((float)texSize.x,	(float)texSize.y);
+			return std::max(std::sqrtf(sepDistance), GetMinDistance() / Grid::MAX_RINGS);
+		}
 	}
 }
 
-void MainState::UpdateVertices()
+RectFloat MainState::GetGridBorder() const
 {
-	std::size_t oldSize = m_vertices.getVertexCount() / 6;
-	std::size_t newSize = m_boids.GetSize();
+	return GetGridBorder(m_border, m_minDistance);
+}
 
-	m_vertices.resize(newSize * 6);
-	 
-	if (newSize > oldSize && m_boidTexture != nullptr)
+void MainState::LoadBoidTextures(res::LoadStrategy strategy)
+{
+	const Config& config = Config::Inst();
+
+	m_boidTextures.clear();
+	m_boidTextures.push_back(&GetContext().GetTextureHolder().Acquire(TextureID::Boid,
+		FromFile<sf::Texture>(RESOURCE_FOLDER + config.Boids.Texture), strategy));
+
+	for (std::size_t i = 0; i < config.Species.size(); ++i)
+	{
+		const std::string& texture = config.Species[i].Texture.empty() ? config.Boids.Texture : config.Species[i].Texture;
+
+		m_boidTextures.push_back(&GetContext().GetTextureHolder().Acquire((TextureID)((int)TextureID::Species + (int)i),
+			FromFile<sf::Texture>(RESOURCE_FOLDER + texture), strategy));
+	}
+}
+void MainState::LoadObstacles()
+{
+	const sf::Texture* mask = nullptr;
+	bool loaded = true;
+
+	if (Config::Inst().Obstacles.Enabled && !Config::Inst().Obstacles.Mask.empty())
 	{
-		const sf::Vector2u texSize = m_boidTexture->getSize();
-		for (std::size_t i = oldSize; i < newSize; ++i)
+		try
+		{
+			mask = &GetContext().GetTextureHolder().Acquire(TextureID::Obstacles,
+				FromFile<sf::Texture>(RESOURCE_FOLDER + Config::Inst().Obstacles.Mask), res::LoadStrategy::Reload);
+		}
+		catch (const std::runtime_error&) // only the shapes then
 		{
-			const std::size_t v = i * 6;
-
-			m_vertices[v + 0].texCoords = sf::Vector2f(0.0f,				0.0f);
-			m_vertices[v + 1].texCoords = sf::Vector2f((float)texSize.x,	0.0f);
-			m_vertices[v + 2].texCoords = sf::Vector2f(0.0f,				(float)texSize.y);
-			m_vertices[v + 3].texCoords = sf::Vector2f((float)texSize.x,	0.0f);
-			m_vertices[v + 4].texCoords = sf::Vector2f(0.0f,				(float)texSize.y);
-			m_vertices[v + 5].texCoords = sf::Vector2f((float)texSize.x,	(float)texSize.y);
+			loaded = false;
 		}
 	}
+
+	m_debug.SetObstacleStatus(loaded);
+
+	m_obstacles.Initialize(m_border, mask);
+}
+void MainState::SetBoidTexCoords(std::size_t first, std::size_t last)
+{
+	// normalized so that the boids do not depend on the size of the texture of their species, which
+	// changes as boids move between slots
+
+	for (std::size_t i = first; i < last; ++i)
+	{
+		const std::size_t v = i * 6;
+
+		m_vertices[v + 0].texCoords = sf::Vector2f(0.0f, 0.0f);
+		m_vertices[v + 1].texCoords = sf::Vector2f(1.0f, 0.0f);
+		m_vertices[v + 2].texCoords = sf::Vector2f(0.0f, 1.0f);
+		m_vertices[v + 3].texCoords = sf::Vector2f(1.0f, 0.0f);
+		m_vertices[v + 4].texCoords = sf::Vector2f(0.0f, 1.0f);
+		m_vertices[v + 5].texCoords = sf::Vector2f(1.0f, 1.0f);
+	}
+}
+
+template<class G>
+void MainState::Flock(G& grid, float dt)
+{
+	grid.ResetBuffers();
+
+	m_boids.PreUpdate(grid);
+	m_boids.UpdateCells(grid);
+
+	const Policy flockPolicy = m_policyTuner.Begin(PolicyStage::Flock);
+	m_boids.Flock(grid, flockPolicy);
+	m_policyTuner.End(PolicyStage::Flock);
+
+	m_boids.Interaction(m_inputRecorder->GetInput(), m_mousePos, dt);
+
+	const Policy avoidPolicy = m_policyTuner.Begin(PolicyStage::Avoid);
+	m_boids.AvoidPredators(m_predators, dt, avoidPolicy);
+	m_boids.AvoidObstacles(m_obstacles, dt, avoidPolicy);
+	m_policyTuner.End(PolicyStage::Avoid);
+
+	m_boids.GatherImpulses(grid, m_impulses, dt);
+}
+
+void MainState::UpdateVertices()
+{
+	// the buffer follows the capacity of the boids rather than their count, so it is only resized
+	// when the boids reallocate and only the texture coordinates of new vertices are written, the
+	// vertices past the count are never drawn
+
+	const std::size_t oldSize = m_vertices.getVertexCount() / 6;
+	const std::size_t newSize = m_boids.GetCapacity();
+
+	if (newSize == oldSize)
+		return;
+
+	m_vertices.resize(newSize * 6);
+
+	if (newSize > oldSize)
+		SetBoidTexCoords(oldSize, newSize);
 }
 
 void MainState::UpdatePolicy()
 {
-	m_policy = m_boids.GetSize() <= Config::Inst().Misc.PolicyThreshold ? Policy::unseq : Policy::par_unseq;
+	m_policyTuner.SetFallback(m_boids.GetSize() <= Config::Inst().Misc.PolicyThreshold ? Policy::unseq : Policy::par_unseq);
+	m_policyTuner.SetSize(m_boids.GetSize());
+}
+
+void MainState::RefreshConfig()
+{
+	Config prev = Config::Inst();
+	for (Rebuild rebuild : m_inputRecorder->RefreshConfig(prev))
+	{
+		PerformRebuild(rebuild, prev);
+	}
 }
 
 void MainState::PerformRebuild(Rebuild rebuild, Config& prev)
@@ -225,7 +374,13 @@ void MainState::PerformRebuild(Rebuild rebuild, Config& prev)
 		case Rebuild::Grid:
 		{
 			m_minDistance = GetMinDistance();
-			m_grid.Initialize(GetGridBorder(), sf::Vector2f(m_minDistance, m_minDistance) * 2.0f);
+			m_cellSize = GetCellSize();
+			m_grid.Initialize(GetGridBorder(), sf::Vector2f(m_cellSize, m_cellSize));
+			m_spatialHash.Initialize(sf::Vector2f(m_cellSize, m_cellSize));
+
+			m_predators.Initialize(m_border);
+
+			m_policyTuner.Retune(); // neighbour counts have changed
 
 			break;
 		}
@@ -244,7 +399,7 @@ void MainState::PerformRebuild(Rebuild rebuild, Config& prev)
 					m_boids.Push(pos);
 				}
 			}
-			else
+			else if (m_boids.GetSize() > Config::Inst().Boids.Count) // may already be below after removing by radius
 			{
 				m_boids.Pop(m_boids.GetSize() - Config::Inst().Boids.Count);
 			}
@@ -256,11 +411,44 @@ void MainState::PerformRebuild(Rebuild rebuild, Config& prev)
 		}
 		case Rebuild::BoidsTex:
 		{
-			SetBoidTexture(GetContext().GetTextureHolder().Acquire(TextureID::Boid,
-				FromFile<sf::Texture>(RESOURCE_FOLDER + Config::Inst().Boids.Texture), res::LoadStrategy::Reload));
+			LoadBoidTextures(res::LoadStrategy::Reload);
+			break;
+		}
+		case Rebuild::Species:
+		{
+			// shares or species have changed, respawned so that the boids are spread over them again
+
+			m_boids.Clear();
+			m_boids.Reserve(Config::Inst().Boids.Count);
+
+			for (std::size_t i = 0; i < Config::Inst().Boids.Count; ++i)
+			{
+				sf::Vector2f pos = sf::Vector2f(
+					util::Random(0.0f, m_border.width) - m_border.left,
+					util::Random(0.0f, m_border.height) - m_border.top);
+
+				m_boids.Push(pos);
+			}
+
+			LoadBoidTextures(res::LoadStrategy::Reload);
+
+			UpdateVertices();
+			UpdatePolicy();
+
+			break;
+		}
+		case Rebuild::Predators:
+		{
+			m_predators.Initialize(m_border);
+			m_predators.Resize(Config::Inst().Interaction.PredatorCount, m_border);
 
 			break;
 		}
+		case Rebuild::Obstacles:
+		{
+			LoadObstacles();
+			break;
+		}
 		case Rebuild::BoidsCycle:
 		{
 			m_boids.ResetCycleTimes();
@@ -268,12 +456,12 @@ void MainState::PerformRebuild(Rebuild rebuild, Config& prev)
 		}
 		case Rebuild::BackgroundTex:
 		{
-			m_background.Load(GetContext().GetTextureHolder(), sf::Vector2i(m_window->getSize()));
+			m_background.Load(GetContext().GetTextureHolder(), sf::Vector2i(m_size));
 			break;
 		}
 		case Rebuild::BackgroundProp:
 		{
-			m_background.LoadProperties(sf::Vector2i(m_window->getSize()));
+			m_background.LoadProperties(sf::Vector2i(m_size));
 
 			m_window->SetClearColor(sf::Color(
 				(std::uint8_t)(Config::Inst().Background.Color.x * 255.999f),
@@ -289,6 +477,9 @@ void MainState::PerformRebuild(Rebuild rebuild, Config& prev)
 		}
 		case Rebuild::Window:
 		{
+			if (!m_window->isOpen()) // headless, nothing to pace
+				break;
+
 			m_window->SetFramerate(Config::Inst().Misc.MaxFramerate);
 			m_window->SetVerticalSync(Config::Inst().Misc.VerticalSync);
 			break;
@@ -300,7 +491,7 @@ void MainState::PerformRebuild(Rebuild rebuild, Config& prev)
 		}
 		case Rebuild::Fluid:
 		{
-			m_fluid.Initialize(m_window->getSize());
+			m_fluid.Initialize(m_size);
 			break;
 		}
 	}
@@ -327,17 +518,14 @@ void MainState::InteractionFluid(float dt)
 	}
 }
 
-void MainState::InteractionAddBoids()
+void MainState::InteractionAddBoids(const InputHandler& input)
 {
-	if (m_inputHandler->GetKeyHeld(sf::Keyboard::Key::RAlt) && m_inputHandler->GetButtonHeld(sf::Mouse::Button::Middle))
+	if (input.GetKeyHeld(sf::Keyboard::Key::RAlt) && input.GetButtonHeld(sf::Mouse::Button::Middle))
 	{
 		const sf::Vector2f mouseDelta = vu::Direction(m_mousePosPrev, m_mousePos);
 		if (mouseDelta.lengthSquared() > Config::Inst().Interaction.BoidAddMouseDiff)
 		{
-			for (int i = 0; i < Config::Inst().Interaction.BoidAddAmount; ++i)
-			{
-				m_boids.Push(m_mousePos, vu::RotatePoint(mouseDelta, {}, util::Random(-1.0f, 1.0f)));
-			}
+			m_boids.PushMany((std::size_t)Config::Inst().Interaction.BoidAddAmount, m_mousePos, mouseDelta, 1.0f);
 
 			UpdateVertices();
 			UpdatePolicy();
@@ -345,9 +533,23 @@ void MainState::InteractionAddBoids()
 	}
 }
 
-void MainState::InteractionRemoveBoids()
+void MainState::InteractionRemoveBoids(const InputHandler& input)
 {
-	if (m_inputHandler->GetKeyHeld(sf::Keyboard::Key::Delete) && m_boids.GetSize() > Config::Inst().Boids.Count)
+	if (input.GetKeyHeld(sf::Keyboard::Key::RAlt) && input.GetKeyHeld(sf::Keyboard::Key::Delete)) // remove around the mouse
+	{
+		const float radius = Config::Inst().Interaction.BoidRemoveRadius;
+
+		const std::size_t removed = Config::Inst().Misc.GridHashed ? 
+			m_boids.Remove(m_spatialHash, m_mousePos, radius) : 
+			m_boids.Remove(m_grid, m_mousePos, radius);
+
+		if (removed > 0)
+		{
+			UpdateVertices();
+			UpdatePolicy();
+		}
+	}
+	else if (input.GetKeyHeld(sf::Keyboard::Key::Delete) && m_boids.GetSize() > Config::Inst().Boids.Count)
 	{
 		std::size_t removeAmount = std::min(
 			m_boids.GetSize() - Config::Inst().Boids.Count,
@@ -360,9 +562,9 @@ void MainState::InteractionRemoveBoids()
 	}
 }
 
-void MainState::InteractionAddImpulse()
+void MainState::InteractionAddImpulse(const InputHandler& input)
 {
-	if (Config::Inst().Impulse.Enabled && m_inputHandler->GetButtonPressed(sf::Mouse::Button::Left))
+	if (Config::Inst().Impulse.Enabled && input.GetButtonPressed(sf::Mouse::Button::Left))
 	{
 		m_impulses.emplace_back(m_mousePos, Config::Inst().Impulse.Speed, Config::Inst().Impulse.Size, -Config::Inst().Impulse.Size);
 	}
@@ -11,13 +11,19 @@
 #include "AudioMeter.h"
 #include "Background.h"
 #include "Grid.h"
+#include "SpatialHash.h"
 #include "Impulse.h"
 #include "BoidContainer.h"
+#include "PredatorContainer.h"
+#include "ObstacleField.h"
 #include "Fluid.h"
+#include "TrajectoryWriter.h"
+#include "PolicyTuner.h"
 
 class Window;
 class Camera;
 class InputHandler;
+class InputRecorder;
 class Config;
 
 enum class Rebuild;
@@ -28,7 +34,9 @@ public:
 	MainState(Context context);
 
 public:
-	void Initialize();
+	// size of what is drawn to, the window or a capture target when there is no window
+	//
+	void Initialize(const sf::Vector2u& size);
 
 	bool HandleEvent(const sf::Event& event) override;
 
@@ -37,41 +45,57 @@ public:
 	bool FixedUpdate(float dt) override;
 	bool PostUpdate(float dt, float interp) override;
 
-	void Draw() override;
+	void Draw(sf::RenderTarget& target) override;
+
+public:
+	[[nodiscard]] static RectFloat GetGridBorder(const RectFloat& border, float minDistance);
+	[[nodiscard]] static float GetMinDistance();
+	[[nodiscard]] static float GetCellSize();
 
 private:
 	RectFloat GetGridBorder() const;
-	float GetMinDistance() const;
 
-	void SetBoidTexture(sf::Texture& texture);
+	void LoadBoidTextures(res::LoadStrategy strategy);
+	void LoadObstacles();
+	void SetBoidTexCoords(std::size_t first, std::size_t last);
 
 private:
+	template<class G>
+	void Flock(G& grid, float dt);
+
 	void UpdateVertices();
 	void UpdatePolicy();
 
+	void RefreshConfig();
 	void PerformRebuild(Rebuild rebuild, Config& prev);
 
 	void InteractionFluid(float dt);
-	void InteractionAddBoids();
-	void InteractionRemoveBoids();
-	void InteractionAddImpulse();
+	void InteractionAddBoids(const InputHandler& input);
+	void InteractionRemoveBoids(const InputHandler& input);
+	void InteractionAddImpulse(const InputHandler& input);
 	void UpdateImpulses(float dt);
 
 private:
 	Window*						m_window		{nullptr};
 	Camera*						m_camera		{nullptr};
 	InputHandler*				m_inputHandler	{nullptr};
+	InputRecorder*				m_inputRecorder	{nullptr};
 
 	Grid						m_grid;
+	SpatialHash					m_spatialHash;
 	Debug						m_debug;
 	IAudioMeterInfo::Ptr		m_audioMeter	{nullptr};
 	Background					m_background;
 	Fluid						m_fluid;
+	TrajectoryWriter			m_trajectory;
 
 	BoidContainer				m_boids;
 	sf::VertexArray				m_vertices;
+	PredatorContainer			m_predators;
+	ObstacleField				m_obstacles;
 	std::vector<Impulse>		m_impulses;
 	RectFloat					m_border;
+	sf::Vector2u				m_size;
 
 	sf::Vector2f				m_mousePos;
 	sf::Vector2f				m_mousePosPrev;
@@ -80,7 +104,8 @@ private:
 	sf::Vector2i				m_fluidMousePosPrev;
 
 	float						m_minDistance	{0.0f};
-	Policy						m_policy		{Policy::unseq};
+	float						m_cellSize		{0.0f};
+	PolicyTuner					m_policyTuner;
 
-	sf::Texture*				m_boidTexture	{nullptr};
+	std::vector<sf::Texture*>	m_boidTextures; // one per species
 };
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include "ObstacleField.h"
+
+#include <SFML/Graphics/Image.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+#include "VectorUtilities.hpp"
+
+#include "Config.h"
+
+namespace
+{
+	constexpr float FAR_AWAY = 1e20f; // squared distance of cells without anything to measure to
+}
+
+void ObstacleField::Initialize(const RectFloat& border, const sf::Texture* mask)
+{
+	const ObstaclesConfig& config = Config::Inst().Obstacles;
+
+	m_border	= border;
+	m_cellSize	= std::max(config.CellSize, 1.0f);
+	m_width		= std::max((int)std::ceilf(border.width / m_cellSize), 1);
+	m_height	= std::max((int)std::ceilf(border.height / m_cellSize), 1);
+
+	m_solid.assign((std::size_t)m_width * m_height, 0);
+	m_distances.assign((std::size_t)m_width * m_height, 0.0f);
+
+	m_empty = true;
+
+	if (!config.Enabled)
+		return;
+
+	Rasterize(mask);
+
+	m_empty = std::ranges::find(m_solid, 1) == m_solid.end();
+
+	if (m_empty)
+		return;
+
+	Transform();
+
+	// drawn as one texture stretched over the border with a texel per cell
+
+	sf::Image image(sf::Vector2u((unsigned)m_width, (unsigned)m_height), sf::Color::Transparent);
+
+	const sf::Color color(
+		(std::uint8_t)(config.Color.x * 255.0f),
+		(std::uint8_t)(config.Color.y * 255.0f),
+		(std::uint8_t)(config.Color.z * 255.0f));
+
+	for (int y = 0; y < m_height; ++y)
+	{
+		for (int x = 0; x < m_width; ++x)
+		{
+			if (m_solid[IX(x, y)])
+				image.setPixel(sf::Vector2u((unsigned)x, (unsigned)y), color);
+		}
+	}
+
+	if (!m_texture.loadFromImage(image))
+		throw std::runtime_error("Failed to create obstacle texture");
+
+	m_texture.setSmooth(true);
+
+	const float right	= border.left + (float)m_width * m_cellSize;
+	const float bottom	= border.top + (float)m_height * m_cellSize;
+
+	m_vertices.setPrimitiveType(sf::PrimitiveType::TriangleStrip);
+	m_vertices.resize(4);
+
+	m_vertices[0] = sf::Vertex{ sf::Vector2f(border.left, border.top),	sf::Color::White, sf::Vector2f(0.0f, 0.0f) };
+	m_vertices[1] = sf::Vertex{ sf::Vector2f(right, border.top),		sf::Color::White, sf::Vector2f((float)m_width, 0.0f) };
+	m_vertices[2] = sf::Vertex{ sf::Vector2f(border.left, bottom),		sf::Color::White, sf::Vector2f(0.0f, (float)m_height) };
+	m_vertices[3] = sf::Vertex{ sf::Vector2f(right, bottom),			sf::Color::White, sf::Vector2f((float)m_width, (float)m_height) };
+}
+
+bool ObstacleField::IsEmpty() const noexcept
+{
+	return m_empty;
+}
+
+float ObstacleField::Sample(const sf::Vector2f& position, sf::Vector2f& gradient) const
+{
+	// samples are at the center of every cell, the distance is interpolated between the four around
+	// the position and the gradient is the derivative of that interpolation
+
+	const sf::Vector2f cell = (position - m_border.Position()) / m_cellSize - sf::Vector2f(0.5f, 0.5f);
+
+	const float cx = std::clamp(cell.x, 0.0f, (float)(m_width - 1));
+	const float cy = std::clamp(cell.y, 0.0f, (float)(m_height - 1));
+
+	const int x0 = std::min((int)cx, std::max(m_width - 2, 0));
+	const int y0 = std::min((int)cy, std::max(m_height - 2, 0));
+	const int x1 = std::min(x0 + 1, m_width - 1);
+	const int y1 = std::min(y0 + 1, m_height - 1);
+
+	const float tx = cx - (float)x0;
+	const float ty = cy - (float)y0;
+
+	const float d00 = m_distances[IX(x0, y0)];
+	const float d10 = m_distances[IX(x1, y0)];
+	const float d01 = m_distances[IX(x0, y1)];
+	const float d11 = m_distances[IX(x1, y1)];
+
+	gradient = sf::Vector2f(
+		((d10 - d00) * (1.0f - ty) + (d11 - d01) * ty) / m_cellSize,
+		((d01 - d00) * (1.0f - tx) + (d11 - d10) * tx) / m_cellSize);
+
+	return util::Lerp(util::Lerp(d00, d10, tx), util::Lerp(d01, d11, tx), ty);
+}
+
+void ObstacleField::Draw(sf::RenderTarget& target) const
+{
+	if (m_empty)
+		return;
+
+	sf::RenderStates states;
+	states.texture = &m_texture;
+
+	target.draw(m_vertices, states);
+}
+
+void ObstacleField::Rasterize(const sf::Texture* mask)
+{
+	const ObstaclesConfig& config = Config::Inst().Obstacles;
+
+	std::optional<sf::Image> image;
+	if (mask != nullptr)
+		image = mask->copyToImage();
+
+	for (int y = 0; y < m_height; ++y)
+	{
+		for (int x = 0; x < m_width; ++x)
+		{
+			const sf::Vector2f center = m_border.Position() + sf::Vector2f((float)x + 0.5f, (float)y + 0.5f) * m_cellSize;
+
+			bool solid = false;
+
+			for (const ObstacleCircle& circle : config.Circles)
+			{
+				if (vu::DistanceSq(center, circle.Position) <= circle.Radius * circle.Radius)
+				{
+					solid = true;
+					break;
+				}
+			}
+
+			for (std::size_t p = 0; p < config.Polygons.size() && !solid; ++p) // even-odd rule
+			{
+				const std::vector<sf::Vector2f>& polygon = config.Polygons[p];
+
+				for (std::size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+				{
+					const sf::Vector2f& a = polygon[i];
+					const sf::Vector2f& b = polygon[j];
+
+					if ((a.y > center.y) != (b.y > center.y) &&
+						center.x < (b.x - a.x) * (center.y - a.y) / (b.y - a.y) + a.x)
+					{
+						solid = !solid;
+					}
+				}
+			}
+
+			if (image && !solid)
+			{
+				const sf::Vector2u size = image->getSize();
+
+				const sf::Vector2u pixel(
+					std::min((unsigned)((center.x - m_border.left) / m_border.width * (float)size.x), size.x - 1),
+					std::min((unsigned)((center.y - m_border.top) / m_border.height * (float)size.y), size.y - 1));
+
+				const sf::Color color = image->getPixel(pixel);
+
+				solid = color.a > 127 && (color.r + color.g + color.b) < 3 * 128;
+			}
+
+			m_solid[IX(x, y)] = solid;
+		}
+	}
+}
+
+void ObstacleField::Transform()
+{
+	// exact euclidean distance transform, first along every column and then along every row of the
+	// result, once to the closest solid cell from outside and once to the closest free cell from
+	// inside, their difference is the signed distance with the surface halfway between cells
+
+	const int size = std::max(m_width, m_height);
+
+	std::vector<float> f(size), d(size), z(size + 1);
+	std::vector<int> v(size);
+
+	std::vector<float> outside(m_solid.size());
+	std::vector<float> inside(m_solid.size());
+
+	const auto transform = [&](std::vector<float>& grid)
+		{
+			for (int x = 0; x < m_width; ++x)
+			{
+				for (int y = 0; y < m_height; ++y)
+					f[y] = grid[IX(x, y)];
+
+				Transform1D(f.data(), d.data(), v.data(), z.data(), m_height);
+
+				for (int y = 0; y < m_height; ++y)
+					grid[IX(x, y)] = d[y];
+			}
+
+			for (int y = 0; y < m_height; ++y)
+			{
+				Transform1D(&grid[IX(0, y)], d.data(), v.data(), z.data(), m_width);
+				std::copy(d.begin(), d.begin() + m_width, grid.begin() + IX(0, y));
+			}
+		};
+
+	for (std::size_t i = 0; i < m_solid.size(); ++i)
+	{
+		outside[i]	= m_solid[i] ? 0.0f : FAR_AWAY;
+		inside[i]	= m_solid[i] ? FAR_AWAY : 0.0f;
+	}
+
+	transform(outside);
+	transform(inside);
+
+	for (std::size_t i = 0; i < m_solid.size(); ++i)
+		m_distances[i] = (std::sqrtf(outside[i]) - std::sqrtf(inside[i])) * m_cellSize;
+}
+
+void ObstacleField::Transform1D(const float* f, float* d, int* v, float* z, int n)
+{
+	int k = 0;
+
+	v[0] = 0;
+	z[0] = -FAR_AWAY;
+	z[1] = +FAR_AWAY;
+
+	for (int q = 1; q < n; ++q)
+	{
+		float s = ((f[q] + (float)(q * q)) - (f[v[k]] + (float)(v[k] * v[k]))) / (float)(2 * q - 2 * v[k]);
+
+		while (s <= z[k])
+		{
+			--k;
+			s = ((f[q] + (float)(q * q)) - (f[v[k]] + (float)(v[k] * v[k]))) / (float)(2 * q - 2 * v[k]);
+		}
+
+		++k;
+
+		v[k]		= q;
+		z[k]		= s;
+		z[k + 1]	= +FAR_AWAY;
+	}
+
+	k = 0;
+
+	for (int q = 0; q < n; ++q)
+	{
+		while (z[k + 1] < (float)q)
+			++k;
+
+		const float dq = (float)(q - v[k]);
+		d[q] = dq * dq + f[v[k]];
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include "Rectangle.hpp"
+
+// static obstacles baked into a signed distance field over the border, negative within obstacles,
+// avoiding them is a single bilinear lookup of the distance and its gradient per boid no matter how
+// many obstacles there are, the field is only rebuilt when the obstacles change
+//
+class ObstacleField
+{
+public:
+	ObstacleField() = default;
+
+	ObstacleField(const ObstacleField&) = delete;
+	ObstacleField& operator=(const ObstacleField&) = delete;
+
+	// rasterizes the circles, polygons and mask of the config, the mask is stretched over the border
+	// and its dark opaque pixels are solid, may be null
+	//
+	void Initialize(const RectFloat& border, const sf::Texture* mask);
+
+public:
+	[[nodiscard]] bool IsEmpty() const noexcept;
+
+	// returns the signed distance at the position and writes its gradient, which points away from
+	// the closest obstacle, positions beyond the border take the distance at the closest edge
+	//
+	[[nodiscard]] float Sample(const sf::Vector2f& position, sf::Vector2f& gradient) const;
+
+public:
+	void Draw(sf::RenderTarget& target) const;
+
+private:
+	void Rasterize(const sf::Texture* mask);
+	void Transform();
+
+	// squared distances in one dimension as the lower envelope of the parabolas rooted at every
+	// sample, linear in the number of samples (Felzenszwalb and Huttenlocher)
+	//
+	static void Transform1D(const float* f, float* d, int* v, float* z, int n);
+
+	[[nodiscard]] constexpr int IX(int x, int y) const;
+
+private:
+	RectFloat					m_border;
+	float						m_cellSize	{1.0f};
+	int							m_width		{0};
+	int							m_height	{0};
+	bool						m_empty		{true};
+
+	std::vector<std::uint8_t>	m_solid;
+	std::vector<float>			m_distances;
+
+	sf::Texture					m_texture;
+	sf::VertexArray				m_vertices;
+};
+
+constexpr int ObstacleField::IX(int x, int y) const
+{
+	return x + y * m_width;
+}
@@ -20,4 +20,17 @@ inline auto PolicySelect(F&& f, Policy p)
 	case Policy::par:		return f(std::execution::par);
 	case Policy::par_unseq:	return f(std::execution::par_unseq);
 	}
-}
\ No newline at end of file
+}
+
+// same policy without vectorization, for loops whose iterations allocate or touch thread local
+// state, which is not allowed to interleave within a thread
+//
+constexpr Policy Sequenced(Policy p)
+{
+	switch (p)
+	{
+	case Policy::unseq:		return Policy::seq;
+	case Policy::par_unseq:	return Policy::par;
+	default:				return p;
+	}
+}
@@ -0,0 +1,97 @@
+#include "PolicyTuner.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Config.h"
+
+Policy PolicyTuner::GetPolicy(PolicyStage stage) const noexcept
+{
+	if (!Config::Inst().Misc.PolicyAutoTune)
+		return m_fallback;
+
+	const StageState& state = m_stages[(std::size_t)stage];
+	return state.tuning ? CANDIDATES[state.candidate] : state.best;
+}
+
+void PolicyTuner::SetFallback(Policy policy)
+{
+	m_fallback = policy;
+}
+void PolicyTuner::SetSize(std::size_t size)
+{
+	const double diff = std::abs((double)size - (double)m_size);
+
+	if (diff > (double)m_size * RESIZE)
+	{
+		m_size = size;
+		Retune();
+	}
+}
+
+Policy PolicyTuner::Begin(PolicyStage stage)
+{
+	m_stages[(std::size_t)stage].start = Clock::now();
+	return GetPolicy(stage);
+}
+
+void PolicyTuner::End(PolicyStage stage)
+{
+	if (!Config::Inst().Misc.PolicyAutoTune)
+		return;
+
+	StageState& state = m_stages[(std::size_t)stage];
+
+	const Clock::time_point now = Clock::now();
+	Record(state, std::chrono::duration<double>(now - state.start).count(), now);
+}
+
+void PolicyTuner::Retune()
+{
+	for (StageState& state : m_stages)
+	{
+		state.tuning	= true;
+		state.candidate = 0;
+		state.sample	= 0;
+	}
+}
+
+void PolicyTuner::Record(StageState& state, double time, Clock::time_point now)
+{
+	if (state.tuning)
+	{
+		double& candidateTime = state.times[state.candidate];
+		candidateTime = (state.sample == 0) ? time : std::min(candidateTime, time);
+
+		if (++state.sample < SAMPLES)
+			return;
+
+		state.sample = 0;
+
+		if (++state.candidate < CANDIDATES.size())
+			return;
+
+		const auto fastest = std::min_element(state.times.begin(), state.times.end());
+
+		state.best			= CANDIDATES[std::distance(state.times.begin(), fastest)];
+		state.tunedTime		= *fastest;
+		state.averageTime	= *fastest;
+		state.tunedAt		= now;
+		state.candidate		= 0;
+		state.tuning		= false;
+
+		return;
+	}
+
+	state.averageTime += (time - state.averageTime) * 0.1; // smooth out single slow frames
+
+	const bool expired = std::chrono::duration<float>(now - state.tunedAt).count() > Config::Inst().Misc.PolicyTuneInterval;
+	const bool drifted = std::abs(state.averageTime - state.tunedTime) > state.tunedTime * DRIFT;
+
+	if (expired || drifted) // e.g., rule distances or available cores have changed
+	{
+		state.tuning	= true;
+		state.candidate = 0;
+		state.sample	= 0;
+	}
+}
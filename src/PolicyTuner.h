@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include "PolicySelect.h"
+
+enum class PolicyStage
+{
+	Flock,
+	Avoid,			// predators and obstacles, timed together
+	UpdateVertices,
+	Count
+};
+
+// picks the fastest execution policy per stage by timing every candidate for a few runs, the
+// choice is revisited periodically, when the boid count changes noticeably or when the measured
+// time drifts away from what was measured when tuning, falls back to the threshold policy when
+// auto tuning is disabled
+//
+class PolicyTuner
+{
+private:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr std::array<Policy, 4> CANDIDATES	= { Policy::seq, Policy::unseq, Policy::par, Policy::par_unseq };
+	static constexpr std::size_t SAMPLES				= 3;	// runs per candidate, the fastest is kept
+	static constexpr double DRIFT						= 0.5;	// relative change in time that triggers a retune
+	static constexpr double RESIZE						= 0.25; // relative change in size that triggers a retune
+
+	struct StageState
+	{
+		Policy				best		{Policy::unseq};
+		bool				tuning		{true};
+		std::size_t			candidate	{0};
+		std::size_t			sample		{0};
+
+		std::array<double, CANDIDATES.size()> times{};
+
+		double				tunedTime	{0.0};
+		double				averageTime	{0.0};
+		Clock::time_point	tunedAt;
+		Clock::time_point	start;
+	};
+
+public:
+	PolicyTuner() = default;
+
+public:
+	[[nodiscard]] Policy GetPolicy(PolicyStage stage) const noexcept;
+
+	void SetFallback(Policy policy);
+	void SetSize(std::size_t size);
+
+public:
+	// returns the policy to run the stage with, must be paired with End
+	//
+	Policy Begin(PolicyStage stage);
+	void End(PolicyStage stage);
+
+	void Retune();
+
+private:
+	void Record(StageState& state, double time, Clock::time_point now);
+
+private:
+	std::array<StageState, (std::size_t)PolicyStage::Count> m_stages;
+
+	Policy		m_fallback	{Policy::unseq};
+	std::size_t	m_size		{0};
+};
@@ -0,0 +1,214 @@
+#include "PredatorContainer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BoidContainer.h"
+
+#include "CommonUtilities.hpp"
+#include "VectorUtilities.hpp"
+
+#include "Config.h"
+
+void PredatorContainer::Initialize(const RectFloat& border)
+{
+	// cells as large as the distance that boids keep to predators, a boid within that distance of
+	// a predator is therefore always in one of the 3x3 cells around it
+
+	const float cellSize = std::sqrtf(Config::Inst().Interaction.PredatorDistance);
+
+	m_scanAll = (cellSize < FLT_EPSILON || border.width < cellSize * 3.0f || border.height < cellSize * 3.0f);
+
+	if (!m_scanAll)
+		m_grid.Initialize(border, sf::Vector2f(cellSize, cellSize));
+
+	Bin();
+}
+
+std::size_t PredatorContainer::GetSize() const noexcept
+{
+	return m_positions.size();
+}
+
+void PredatorContainer::Resize(std::size_t count, const RectFloat& border)
+{
+	const std::size_t size = GetSize();
+
+	m_positions.resize(count);
+	m_prevPositions.resize(count);
+	m_velocities.resize(count);
+	m_prevVelocities.resize(count);
+	m_targets.resize(count, UINT32_MAX);
+
+	for (std::size_t i = size; i < count; ++i)
+	{
+		m_prevPositions[i] = m_positions[i] = sf::Vector2f(
+			util::Random(0.0f, border.width) + border.left,
+			util::Random(0.0f, border.height) + border.top);
+
+		m_prevVelocities[i] = m_velocities[i] = sf::Vector2f(
+			util::Random(-1.0f, 1.0f),
+			util::Random(-1.0f, 1.0f)) * Config::Inst().Interaction.PredatorSpeed;
+	}
+
+	m_vertices.setPrimitiveType(sf::PrimitiveType::Triangles);
+	m_vertices.resize(count * 6);
+
+	for (std::size_t i = size; i < count; ++i) // normalized, same as the boids
+	{
+		const std::size_t v = i * 6;
+
+		m_vertices[v + 0].texCoords = sf::Vector2f(0.0f, 0.0f);
+		m_vertices[v + 1].texCoords = sf::Vector2f(1.0f, 0.0f);
+		m_vertices[v + 2].texCoords = sf::Vector2f(0.0f, 1.0f);
+		m_vertices[v + 3].texCoords = sf::Vector2f(1.0f, 0.0f);
+		m_vertices[v + 4].texCoords = sf::Vector2f(0.0f, 1.0f);
+		m_vertices[v + 5].texCoords = sf::Vector2f(1.0f, 1.0f);
+	}
+
+	Bin();
+}
+
+void PredatorContainer::Update(const BoidContainer& boids, const RectFloat& border, float dt)
+{
+	const Config& config = Config::Inst();
+
+	std::swap(m_prevPositions, m_positions);
+	std::swap(m_prevVelocities, m_velocities);
+
+	const float catchDistance = std::max(config.Boids.Width, config.Boids.Height);
+
+	for (std::size_t i = 0; i < GetSize(); ++i)
+	{
+		sf::Vector2f velocity = m_prevVelocities[i];
+
+		std::uint32_t index = (m_targets[i] != UINT32_MAX) ? boids.GetIndex(m_targets[i]) : UINT32_MAX;
+
+		if (index != UINT32_MAX && vu::DistanceSq(m_prevPositions[i], boids.GetPositions()[index]) < catchDistance * catchDistance)
+			index = UINT32_MAX; // caught, moves on to the next
+
+		if (index == UINT32_MAX) // removed or caught
+		{
+			Retarget(i, boids);
+			index = (m_targets[i] != UINT32_MAX) ? boids.GetIndex(m_targets[i]) : UINT32_MAX;
+		}
+
+		if (index != UINT32_MAX)
+		{
+			const sf::Vector2f desired = vu::Normalize(
+				vu::Direction(m_prevPositions[i], boids.GetPositions()[index]), config.Interaction.PredatorSpeed);
+
+			velocity += vu::Limit(vu::Direction(velocity, desired), config.Boids.SteerMax);
+		}
+
+		m_velocities[i] = vu::Limit(velocity, config.Interaction.PredatorSpeed);
+
+		// wrap around rather than turn at the border, the hunt is what steers them
+
+		const sf::Vector2f moved = m_prevPositions[i] + m_velocities[i] * dt;
+		sf::Vector2f position = moved;
+
+		if (position.x < border.left)		position.x += border.width;
+		if (position.x > border.Right())	position.x -= border.width;
+		if (position.y < border.top)		position.y += border.height;
+		if (position.y > border.Bottom())	position.y -= border.height;
+
+		if (position != moved) // teleported, nothing to interpolate from
+			m_prevPositions[i] = position;
+
+		m_positions[i] = position;
+	}
+
+	Bin();
+}
+
+void PredatorContainer::UpdateVertices(float interp)
+{
+	const Config& config = Config::Inst();
+
+	const sf::Color color = sf::Color(
+		(std::uint8_t)(config.Interaction.PredatorColor.x * 255.0f),
+		(std::uint8_t)(config.Interaction.PredatorColor.y * 255.0f),
+		(std::uint8_t)(config.Interaction.PredatorColor.z * 255.0f));
+
+	const sf::Vector2f hSize = config.BoidHalfSize * 2.0f; // stands out from the boids
+
+	for (std::size_t i = 0; i < GetSize(); ++i)
+	{
+		const sf::Vector2f position = vu::Lerp(m_prevPositions[i], m_positions[i], interp);
+		const sf::Vector2f velocity = vu::Lerp(m_prevVelocities[i], m_velocities[i], interp);
+		const float speed = velocity.length();
+
+		const sf::Vector2f heading = (speed > FLT_EPSILON) ? velocity / speed : sf::Vector2f(1.0f, 0.0f);
+
+		const sf::Vector2f x = sf::Vector2f(heading.x, heading.y) * hSize.x;
+		const sf::Vector2f y = sf::Vector2f(-heading.y, heading.x) * hSize.y;
+
+		const sf::Vector2f topLeft	= position - x + y;
+		const sf::Vector2f topRight = position + x + y;
+		const sf::Vector2f botLeft	= position - x - y;
+		const sf::Vector2f botRight	= position + x - y;
+
+		const std::size_t v = i * 6;
+
+		m_vertices[v + 0].position = botLeft;
+		m_vertices[v + 1].position = botRight;
+		m_vertices[v + 2].position = topLeft;
+		m_vertices[v + 3].position = botRight;
+		m_vertices[v + 4].position = topLeft;
+		m_vertices[v + 5].position = topRight;
+
+		for (std::size_t j = 0; j < 6; ++j)
+			m_vertices[v + j].color = color;
+	}
+}
+
+void PredatorContainer::Draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	if (GetSize() > 0)
+		target.draw(m_vertices, states);
+}
+
+void PredatorContainer::Bin()
+{
+	if (m_scanAll)
+		return;
+
+	// counting sort, same as the boids
+
+	m_grid.ResetBuffers();
+
+	m_cells.resize(GetSize());
+	m_order.resize(GetSize());
+
+	for (std::size_t i = 0; i < GetSize(); ++i)
+	{
+		const sf::Vector2i cell = GetCell(m_positions[i]);
+
+		m_cells[i] = m_grid.AtPos(cell);
+		m_grid.Insert(m_cells[i]);
+	}
+
+	m_grid.Scan();
+
+	for (std::size_t i = GetSize(); i-- > 0;)
+		m_order[m_grid.Place(m_cells[i])] = (std::uint32_t)i;
+}
+
+void PredatorContainer::Retarget(std::size_t index, const BoidContainer& boids)
+{
+	if (boids.GetSize() == 0)
+	{
+		m_targets[index] = UINT32_MAX;
+		return;
+	}
+
+	const std::size_t boid = util::Random<std::size_t>(0, boids.GetSize() - 1);
+	m_targets[index] = boids.GetIds()[boid];
+}
+
+sf::Vector2i PredatorContainer::GetCell(const sf::Vector2f& position) const
+{
+	const sf::Vector2f cell = m_grid.RelativePos(position);
+	return sf::Vector2i((int)std::floorf(cell.x), (int)std::floorf(cell.y)); // negative outside the border
+}
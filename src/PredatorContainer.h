@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include "Grid.h"
+#include "Rectangle.hpp"
+
+class BoidContainer;
+
+// predators that each hunt a boid of their own, they are binned into a grid with cells as large as
+// the distance boids keep to them so that a boid only has to test the predators of the 3x3 cells
+// around it, rather than every predator
+//
+class PredatorContainer
+{
+public:
+	PredatorContainer() = default;
+
+	void Initialize(const RectFloat& border);
+
+public:
+	[[nodiscard]] std::size_t GetSize() const noexcept;
+
+	// spawns predators at random within the border or removes the last ones
+	//
+	void Resize(std::size_t count, const RectFloat& border);
+
+	// calls func with the position of every predator in the cells around the position, the distance
+	// is left for the caller to test
+	//
+	template<typename F>
+	void ForEachNear(const sf::Vector2f& position, F&& func) const;
+
+public:
+	void Update(const BoidContainer& boids, const RectFloat& border, float dt);
+	void UpdateVertices(float interp);
+
+	void Draw(sf::RenderTarget& target, sf::RenderStates states) const;
+
+private:
+	void Bin();
+	void Retarget(std::size_t index, const BoidContainer& boids);
+
+	[[nodiscard]] sf::Vector2i GetCell(const sf::Vector2f& position) const;
+
+private:
+	std::vector<sf::Vector2f>	m_positions;
+	std::vector<sf::Vector2f>	m_prevPositions;
+	std::vector<sf::Vector2f>	m_velocities;
+	std::vector<sf::Vector2f>	m_prevVelocities;
+	std::vector<std::uint32_t>	m_targets;			// id of the hunted boid, UINT32_MAX for none
+
+	Grid						m_grid;
+	std::vector<int>			m_cells;
+	std::vector<std::uint32_t>	m_order;			// predators sorted by cell
+	bool						m_scanAll	{true};	// grid is too small for the 3x3 cells not to overlap
+
+	sf::VertexArray				m_vertices;
+};
+
+template<typename F>
+inline void PredatorContainer::ForEachNear(const sf::Vector2f& position, F&& func) const
+{
+	if (m_scanAll)
+	{
+		for (const sf::Vector2f& predator : m_positions)
+			func(predator);
+
+		return;
+	}
+
+	const sf::Vector2i cell = GetCell(position);
+
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			const GridCell other = m_grid.GetCell(m_grid.AtPos(cell.x + dx, cell.y + dy));
+
+			for (int j = other.start; j < other.end; ++j)
+				func(m_positions[m_order[j]]);
+		}
+	}
+}
@@ -16,7 +16,9 @@ enum class FontID
 enum class TextureID
 {
 	Boid,
-	Background
+	Background,
+	Obstacles,
+	Species // first of the textures of the species after the first, one id per species
 };
 
 namespace res
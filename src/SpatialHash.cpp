@@ -0,0 +1,127 @@
+#include "SpatialHash.h"
+
+#include <algorithm>
+
+#include "VectorUtilities.hpp"
+
+#include "Config.h"
+
+void SpatialHash::Initialize(const sf::Vector2f& contDims)
+{
+	m_contDims = contDims;
+	m_stencil = Grid::ToStencil(Config::Inst().Misc.GridStencil);
+
+	if (m_entries.empty())
+	{
+		m_entries.resize(1024);
+		m_mask = m_entries.size() - 1;
+	}
+
+	ResetBuffers();
+}
+
+const sf::Vector2f& SpatialHash::GetContDims() const noexcept
+{
+	return m_contDims;
+}
+GridStencil SpatialHash::GetStencil() const noexcept
+{
+	return m_stencil;
+}
+int SpatialHash::GetCount() const noexcept
+{
+	return m_count;
+}
+
+GridCell SpatialHash::GetCell(std::uint64_t key) const
+{
+	const Entry& entry = m_entries[Find(key)];
+	return GridCell{ entry.start, entry.end };
+}
+
+void SpatialHash::SetStartIndex(std::uint64_t key, int value)
+{
+	if ((std::size_t)(m_count + 1) * 2 > m_entries.size()) // keep load below half
+		Grow();
+
+	const std::size_t slot = Find(key);
+	Entry& entry = m_entries[slot];
+
+	if (entry.start == -1)
+	{
+		m_used.push_back(slot);
+		++m_count;
+	}
+
+	entry.key	= key;
+	entry.start = value;
+}
+void SpatialHash::SetEndIndex(std::uint64_t key, int value)
+{
+	m_entries[Find(key)].end = value;
+}
+
+sf::Vector2f SpatialHash::RelativePos(const sf::Vector2f& position) const
+{
+	return position / m_contDims + sf::Vector2f((float)ORIGIN, (float)ORIGIN);
+}
+std::uint64_t SpatialHash::AtPos(const sf::Vector2i& position) const noexcept
+{
+	return AtPos(position.x, position.y);
+}
+std::uint64_t SpatialHash::AtPos(int x, int y) const noexcept
+{
+	return ((std::uint64_t)(std::uint32_t)x << 32) | (std::uint64_t)(std::uint32_t)y;
+}
+sf::Vector2i SpatialHash::CellPos(std::uint64_t key) const noexcept
+{
+	return sf::Vector2i((int)(std::uint32_t)(key >> 32), (int)(std::uint32_t)key);
+}
+
+void SpatialHash::ResetBuffers()
+{
+	for (const std::size_t slot : m_used) // rather than the whole table, which never shrinks
+		m_entries[slot] = Entry{};
+
+	m_used.clear();
+	m_count = 0;
+}
+
+std::size_t SpatialHash::Find(std::uint64_t key) const
+{
+	std::size_t slot = Hash(key) & m_mask;
+
+	while (m_entries[slot].start != -1 && m_entries[slot].key != key) // linear probing
+		slot = (slot + 1) & m_mask;
+
+	return slot;
+}
+
+std::size_t SpatialHash::Hash(std::uint64_t key)
+{
+	std::uint64_t hash = key * 0x9E3779B97F4A7C15ull; // high bits depend on both coordinates
+	hash ^= hash >> 32;
+
+	return (std::size_t)hash;
+}
+
+void SpatialHash::Grow()
+{
+	std::vector<Entry> entries(m_entries.size() * 2);
+	std::swap(entries, m_entries);
+
+	m_mask = m_entries.size() - 1;
+
+	m_used.clear();
+
+	for (const Entry& entry : entries)
+	{
+		if (entry.start != -1)
+		{
+			const std::size_t slot = Find(entry.key);
+
+			m_entries[slot] = entry;
+			m_used.push_back(slot);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+#include "Grid.h"
+
+// sparse alternative to the grid for huge or unbounded worlds, only occupied cells are stored in an
+// open-addressing table keyed by the packed 32-bit cell coordinates which is rebuilt every tick,
+// memory scales with the peak number of occupied cells and reset cost with the current number, never
+// with the area of the world
+//
+class SpatialHash
+{
+private:
+	static constexpr int ORIGIN = 1 << 15; // cell coordinates are offset so that truncation rounds down near the origin
+
+	struct Entry
+	{
+		std::uint64_t	key		{0};
+		int				start	{-1};
+		int				end		{-1};
+	};
+
+public:
+	SpatialHash() = default;
+
+	void Initialize(const sf::Vector2f& contDims);
+
+public:
+	[[nodiscard]] const sf::Vector2f& GetContDims() const noexcept;
+	[[nodiscard]] GridStencil GetStencil() const noexcept;
+	[[nodiscard]] int GetCount() const noexcept;
+
+	[[nodiscard]] GridCell GetCell(std::uint64_t key) const;
+
+	void SetStartIndex(std::uint64_t key, int value);
+	void SetEndIndex(std::uint64_t key, int value); // one past the last
+
+public:
+	[[nodiscard]] sf::Vector2f RelativePos(const sf::Vector2f& position) const;
+	// every cell has a key of its own, so cells far apart never share an entry
+	//
+	[[nodiscard]] std::uint64_t AtPos(const sf::Vector2i& position) const noexcept;
+	[[nodiscard]] std::uint64_t AtPos(int x, int y) const noexcept;
+
+	[[nodiscard]] sf::Vector2i CellPos(std::uint64_t key) const noexcept;
+
+public:
+	void ResetBuffers();
+
+private:
+	[[nodiscard]] std::size_t Find(std::uint64_t key) const;
+	[[nodiscard]] static std::size_t Hash(std::uint64_t key);
+
+	void Grow();
+
+private:
+	sf::Vector2f				m_contDims;
+	GridStencil					m_stencil	{GridStencil::Auto};
+
+	std::vector<Entry>			m_entries;
+	std::vector<std::size_t>	m_used;		// slots of the occupied entries, the only ones to reset
+	std::size_t					m_mask		{0};
+	int							m_count		{0};
+};
@@ -4,11 +4,13 @@ State::State::Context::Context(
 	Window& window, 
 	Camera& camera, 
 	InputHandler& inputHandler, 
+	InputRecorder& inputRecorder,
 	TextureHolder& textureHolder,
 	FontHolder& fontHolder)
 	: m_window(&window)
 	, m_camera(&camera)
 	, m_inputHandler(&inputHandler)
+	, m_inputRecorder(&inputRecorder)
 	, m_textureHolder(&textureHolder)
 	, m_fontHolder(&fontHolder)
 {
@@ -42,6 +44,15 @@ InputHandler& State::Context::GetInputHandler()
 	return *m_inputHandler;
 }
 
+const InputRecorder& State::Context::GetInputRecorder() const
+{
+	return *m_inputRecorder;
+}
+InputRecorder& State::Context::GetInputRecorder()
+{
+	return *m_inputRecorder;
+}
+
 const TextureHolder& State::Context::GetTextureHolder() const
 {
 	return *m_textureHolder;
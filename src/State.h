@@ -1,6 +1,7 @@
 #pragma once
 
 #include <SFML/Window/Event.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
 
 #include <memory>
 
@@ -9,6 +10,7 @@
 class Window;
 class Camera;
 class InputHandler;
+class InputRecorder;
 
 class State
 {
@@ -18,7 +20,7 @@ public:
 	class Context // holds vital objects
 	{
 	public:
-		Context(Window& window, Camera& camera, InputHandler& inputHandler, TextureHolder& textureHolder, FontHolder& fontHolder);
+		Context(Window& window, Camera& camera, InputHandler& inputHandler, InputRecorder& inputRecorder, TextureHolder& textureHolder, FontHolder& fontHolder);
 
 		const Window& GetWindow() const;
 		Window& GetWindow();
@@ -29,6 +31,9 @@ public:
 		const InputHandler& GetInputHandler() const;
 		InputHandler& GetInputHandler();
 
+		const InputRecorder& GetInputRecorder() const;
+		InputRecorder& GetInputRecorder();
+
 		const TextureHolder& GetTextureHolder() const;
 		TextureHolder& GetTextureHolder();
 
@@ -39,6 +44,7 @@ public:
 		Window*			m_window;
 		Camera*			m_camera;
 		InputHandler*	m_inputHandler;
+		InputRecorder*	m_inputRecorder;
 		TextureHolder*	m_textureHolder;
 		FontHolder*		m_fontHolder;
 	};
@@ -55,7 +61,7 @@ public:
 	virtual bool FixedUpdate(float dt) = 0;
 	virtual bool PostUpdate(float dt, float interp) = 0;
 
-	virtual void Draw() = 0;
+	virtual void Draw(sf::RenderTarget& target) = 0;
 
 protected:
 	auto GetContext() -> Context&;
@@ -0,0 +1,257 @@
+#include "TrajectoryWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "BoidContainer.h"
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+	Close();
+}
+
+bool TrajectoryWriter::IsOpen() const noexcept
+{
+	return m_file.is_open();
+}
+std::uint64_t TrajectoryWriter::GetDropped() const noexcept
+{
+	return m_dropped;
+}
+
+void TrajectoryWriter::Open(const std::string& path, std::size_t bufferSize, bool compress)
+{
+	Close();
+
+	m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!m_file.is_open())
+		throw std::runtime_error("Trajectory file could not be opened: " + path);
+
+	m_slots		= std::vector<Slot>(std::max<std::size_t>(bufferSize, 1));
+	m_head		= 0;
+	m_tail		= 0;
+	m_used		= 0;
+	m_shutdown	= false;
+	m_tick		= 0;
+	m_dropped	= 0;
+	m_compress	= compress;
+	m_prevCount	= 0;
+
+	WriteValue(MAGIC);
+	WriteValue(VERSION);
+	WriteValue((std::uint8_t)(m_compress ? CF_Compressed : CF_Raw));
+
+	m_thread = std::jthread(&TrajectoryWriter::ThreadLoop, this);
+}
+
+void TrajectoryWriter::Close()
+{
+	if (!IsOpen())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_shutdown = true;
+	}
+
+	m_cv.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	m_file.close();
+}
+
+void TrajectoryWriter::Write(const BoidContainer& boids)
+{
+	if (!IsOpen())
+		return;
+
+	const std::uint64_t tick = m_tick++;
+
+	Slot* slot = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_used == m_slots.size()) // writer is lagging behind, rather drop than stall
+		{
+			++m_dropped;
+			return;
+		}
+
+		slot = &m_slots[m_head];
+	}
+
+	// slot is not visible to the writer thread until published below
+
+	const std::size_t count = boids.GetSize();
+
+	slot->tick	= tick;
+	slot->count	= count;
+
+	slot->positions.assign(boids.GetPositions(), boids.GetPositions() + count);
+	slot->velocities.assign(boids.GetVelocities(), boids.GetVelocities() + count);
+	slot->densities.assign(boids.GetDensities(), boids.GetDensities() + count);
+	slot->ids.assign(boids.GetIds(), boids.GetIds() + count);
+	slot->species.assign(boids.GetSpecies(), boids.GetSpecies() + count);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_head = (m_head + 1) % m_slots.size();
+		++m_used;
+	}
+
+	m_cv.notify_one();
+}
+
+void TrajectoryWriter::ThreadLoop()
+{
+	while (true)
+	{
+		const Slot* slot = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]
+			{
+				return m_used > 0 || m_shutdown;
+			});
+
+			if (m_used == 0 && m_shutdown)
+				break;
+
+			slot = &m_slots[m_tail];
+		}
+
+		WriteSlot(*slot);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_tail = (m_tail + 1) % m_slots.size();
+			--m_used;
+		}
+	}
+
+	m_file.flush();
+}
+
+void TrajectoryWriter::WriteSlot(const Slot& slot)
+{
+	std::uint8_t flags = CF_Raw;
+
+	if (m_compress)
+	{
+		flags |= CF_Compressed;
+
+		if (m_prevCount != 0 && m_prevCount == slot.count) // most boids keep their slot between ticks
+			flags |= CF_Delta;
+	}
+
+	WriteValue(slot.tick);
+	WriteValue((std::uint32_t)slot.count);
+	WriteValue(flags);
+
+	WriteStream(slot.positions.data(),	slot.count * sizeof(sf::Vector2f),	sizeof(float),			m_prevPositions,	flags);
+	WriteStream(slot.velocities.data(), slot.count * sizeof(sf::Vector2f),	sizeof(float),			m_prevVelocities,	flags);
+	WriteStream(slot.densities.data(),	slot.count * sizeof(std::uint32_t), sizeof(std::uint32_t),	m_prevDensities,	flags);
+	WriteStream(slot.ids.data(),		slot.count * sizeof(std::uint32_t), sizeof(std::uint32_t),	m_prevIds,			flags);
+	WriteStream(slot.species.data(),	slot.count * sizeof(std::uint8_t),	sizeof(std::uint8_t),	m_prevSpecies,		flags);
+
+	m_prevCount = slot.count;
+}
+
+void TrajectoryWriter::WriteStream(const void* data, std::size_t size, std::size_t width, std::vector<std::uint8_t>& prev, std::uint8_t flags)
+{
+	const auto* bytes = static_cast<const std::uint8_t*>(data);
+
+	if ((flags & CF_Compressed) != CF_Compressed)
+	{
+		WriteValue((std::uint32_t)size);
+		m_file.write(reinterpret_cast<const char*>(bytes), (std::streamsize)size);
+
+		return;
+	}
+
+	m_scratch.resize(size);
+
+	if ((flags & CF_Delta) == CF_Delta)
+	{
+		for (std::size_t i = 0; i < size; ++i)
+			m_scratch[i] = bytes[i] ^ prev[i];
+	}
+	else
+	{
+		std::memcpy(m_scratch.data(), bytes, size);
+	}
+
+	prev.assign(bytes, bytes + size);
+
+	m_shuffled.resize(size);
+	Shuffle(m_scratch.data(), m_shuffled.data(), size, width);
+
+	EncodeZeroRuns(m_shuffled.data(), size, m_encoded);
+
+	WriteValue((std::uint32_t)m_encoded.size());
+	m_file.write(reinterpret_cast<const char*>(m_encoded.data()), (std::streamsize)m_encoded.size());
+}
+
+template<typename T>
+void TrajectoryWriter::WriteValue(const T& value)
+{
+	m_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void TrajectoryWriter::Shuffle(const std::uint8_t* src, std::uint8_t* dst, std::size_t size, std::size_t width)
+{
+	// groups the n:th byte of every element together, the high bytes of slowly changing values then
+	// form long runs of zeroes after the xor
+
+	const std::size_t count = size / width;
+
+	for (std::size_t b = 0; b < width; ++b)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			dst[b * count + i] = src[i * width + b];
+	}
+}
+
+void TrajectoryWriter::EncodeZeroRuns(const std::uint8_t* src, std::size_t size, std::vector<std::uint8_t>& dst)
+{
+	// control byte c < 128 is followed by c + 1 literal bytes, c >= 128 is a run of c - 127 zeroes
+
+	dst.clear();
+	dst.reserve(size / 2);
+
+	std::size_t i = 0;
+	while (i < size)
+	{
+		if (src[i] == 0)
+		{
+			std::size_t run = 0;
+			while (i < size && src[i] == 0 && run < 128)
+			{
+				++run;
+				++i;
+			}
+
+			dst.push_back((std::uint8_t)(127 + run));
+		}
+		else
+		{
+			const std::size_t start = i;
+
+			std::size_t literals = 0;
+			while (i < size && literals < 128 && !(src[i] == 0 && i + 1 < size && src[i + 1] == 0))
+			{
+				++literals;
+				++i;
+			}
+
+			dst.push_back((std::uint8_t)(literals - 1));
+			dst.insert(dst.end(), src + start, src + i);
+		}
+	}
+}
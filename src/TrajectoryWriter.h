@@ -0,0 +1,109 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <string>
+
+class BoidContainer;
+
+// streams the state of every boid per tick to a chunked binary file, the simulation thread only
+// copies the streams into a free slot of a bounded ring buffer while the encoding and writing
+// is done on a background thread, ticks are dropped rather than stalling when the ring is full
+//
+// the file starts with the magic, version and compression flag, followed by a chunk per tick of
+// its tick, boid count and flags, and then a stream each of positions, velocities, densities, ids
+// and species, every stream prefixed by its size in bytes. boids are stored in the order of their
+// slots, which change as boids are removed or species moved, so they are followed by their id
+//
+class TrajectoryWriter
+{
+private:
+	static constexpr std::uint32_t MAGIC	= 0x4A525442; // "BTRJ"
+	static constexpr std::uint32_t VERSION	= 2;
+
+	enum ChunkFlags : std::uint8_t
+	{
+		CF_Raw			= 0,
+		CF_Compressed	= 1 << 0, // streams are byte shuffled and zero run-length encoded
+		CF_Delta		= 1 << 1, // streams are xor:ed with the previous written chunk
+	};
+
+	struct Slot
+	{
+		std::uint64_t				tick	{0};
+		std::size_t					count	{0};
+
+		std::vector<sf::Vector2f>	positions;
+		std::vector<sf::Vector2f>	velocities;
+		std::vector<std::uint32_t>	densities;
+		std::vector<std::uint32_t>	ids;
+		std::vector<std::uint8_t>	species;
+	};
+
+public:
+	TrajectoryWriter() = default;
+	~TrajectoryWriter();
+
+	TrajectoryWriter(const TrajectoryWriter&) = delete;
+	TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+public:
+	[[nodiscard]] bool IsOpen() const noexcept;
+	[[nodiscard]] std::uint64_t GetDropped() const noexcept;
+
+public:
+	// throws if the file could not be opened
+	//
+	void Open(const std::string& path, std::size_t bufferSize, bool compress);
+	void Close();
+
+	// copies the current state of the boids into the ring buffer, never blocks
+	//
+	void Write(const BoidContainer& boids);
+
+private:
+	void ThreadLoop();
+
+	void WriteSlot(const Slot& slot);
+	void WriteStream(const void* data, std::size_t size, std::size_t width, std::vector<std::uint8_t>& prev, std::uint8_t flags);
+
+	template<typename T>
+	void WriteValue(const T& value);
+
+	static void Shuffle(const std::uint8_t* src, std::uint8_t* dst, std::size_t size, std::size_t width);
+	static void EncodeZeroRuns(const std::uint8_t* src, std::size_t size, std::vector<std::uint8_t>& dst);
+
+private:
+	std::ofstream				m_file;
+	std::jthread				m_thread;
+
+	std::vector<Slot>			m_slots;
+	std::size_t					m_head			{0}; // next slot to fill
+	std::size_t					m_tail			{0}; // next slot to write
+	std::size_t					m_used			{0};
+
+	std::mutex					m_mutex;
+	std::condition_variable		m_cv;
+	bool						m_shutdown		{false};
+
+	std::uint64_t				m_tick			{0};
+	std::uint64_t				m_dropped		{0};
+	bool						m_compress		{false};
+
+	// only accessed by the writer thread
+
+	std::vector<std::uint8_t>	m_prevPositions;
+	std::vector<std::uint8_t>	m_prevVelocities;
+	std::vector<std::uint8_t>	m_prevDensities;
+	std::vector<std::uint8_t>	m_prevIds;
+	std::vector<std::uint8_t>	m_prevSpecies;
+	std::vector<std::uint8_t>	m_scratch;
+	std::vector<std::uint8_t>	m_shuffled;
+	std::vector<std::uint8_t>	m_encoded;
+	std::size_t					m_prevCount		{0};
+};
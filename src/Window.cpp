@@ -40,7 +40,7 @@ void Window::HandleEvent(const sf::Event& event)
 
 void Window::Setup()
 {
-	clear(sf::Color(m_clearColor.r, m_clearColor.g, m_clearColor.b, 0));
+	clear(GetClearColor());
 }
 
 void Window::SetFramerate(int frameRate)
@@ -99,6 +99,10 @@ void Window::SetClearColor(sf::Color Color)
 {
 	m_clearColor = Color;
 }
+sf::Color Window::GetClearColor() const
+{
+	return sf::Color(m_clearColor.r, m_clearColor.g, m_clearColor.b, 0);
+}
 
 void Window::SetCursorState(bool flag)
 {
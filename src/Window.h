@@ -45,6 +45,7 @@ public:
 	void SetSettings(const sf::ContextSettings& settings);
 
 	void SetClearColor(sf::Color Color);
+	sf::Color GetClearColor() const;
 
 	// false = hides and grabs the cursor
 	// true = shows and unhooks the cursor
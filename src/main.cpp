@@ -1,7 +1,9 @@
 #include "Application.h"
+#include "Benchmark.h"
 
 #include <exception>
 #include <fstream>
+#include <iostream>
 #include <string>
 #include <filesystem>
 
@@ -22,8 +24,33 @@ std::string Timestamp()
 	return buffer;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+	if (argc > 1 && std::string(argv[1]) == "--benchmark") // headless, returns non-zero on regression
+	{
+		Benchmark benchmark(
+			(argc > 2) ? argv[2] : BENCHMARK_FILE,
+			(argc > 3) ? argv[3] : BENCHMARK_BASELINE_FILE);
+
+		return benchmark.Run() ? 0 : 1;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--capture") // headless, renders to the capture path of the config
+	{
+		try
+		{
+			Application application("Boids", true);
+			application.RunHeadless();
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+
+		return 0;
+	}
+
 	Application application("Boids");
 
 	try